@@ -6,6 +6,8 @@
 #include <sys/socket.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
 
 static int createNonblocking()
 {
@@ -14,6 +16,7 @@ static int createNonblocking()
     {
         LOG_FATAL("%s:%s:%d listen socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
     }
+    return socketfd;
 }
 
 Acceptor::Acceptor(EventLoop* loop, const InetAddress &listenAddr, bool reuseport)
@@ -21,9 +24,12 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress &listenAddr, bool reusepor
     , acceptSocket_(createNonblocking())
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
+    , maxAcceptsPerEvent_(KMaxAcceptsPerEvent)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    , acceptErrors_(0)
     {
         acceptSocket_.setReuseAddr(true);
-        acceptSocket_.setReusePort(true);
+        acceptSocket_.setReusePort(reuseport);
         acceptSocket_.bindAddress(listenAddr); // bind
         // TcpServer::start()  Acceptor.listen  有新用户的连接，要执行一个回调:
         // connfd => channel => subloop
@@ -34,6 +40,7 @@ Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    ::close(idleFd_);
 }
     
 void Acceptor::listen()
@@ -44,27 +51,82 @@ void Acceptor::listen()
 }
 
 // listenfd有事件发生了，就是有新用户连接了
+// LT模式下每次事件最多accept maxAcceptsPerEvent_个连接；ET模式下不会再通知，必须一直accept到EAGAIN
+// accept到的连接攒成一批再交给TcpServer，TcpServer给每个subloop只投递一次回调
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if(connfd >= 0)
+    int limit = acceptChannel_.isEdgeTriggered() ? INT_MAX : maxAcceptsPerEvent_;
+    for(int i = 0;i < limit;i++)
     {
-        if(newConnectionCallback_)
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if(connfd >= 0)
+        {
+            accepted_.emplace_back(connfd, peerAddr);
+            continue;
+        }
+
+        int savedErrno = errno;
+        if(savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) // 全连接队列已经取空了
+        {
+            break;
+        }
+        acceptErrors_.fetch_add(1, std::memory_order_relaxed); // 很少发生，不在乎lock前缀
+        if(savedErrno == ECONNABORTED || savedErrno == EINTR || savedErrno == EPROTO) // 对端已经放弃了这个连接，接着accept下一个
         {
-            newConnectionCallback_(connfd, peerAddr); // 轮询找到subLoop，唤醒，分发当前的新客户端的channel
+            continue;
         }
-        else
+        if(savedErrno == EMFILE || savedErrno == ENFILE) // accept fd达到上限
         {
-            ::close(connfd);
+            LOG_ERROR("%s:%s:%d sockfd reached limit:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+            if(dropConnection())
+            {
+                continue;
+            }
+            break;
         }
+        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+        break;
+    }
+
+    if(accepted_.empty())
+    {
+        return;
+    }
+    if(newConnectionsCallback_)
+    {
+        newConnectionsCallback_(accepted_); // 按照负载均衡策略找到subLoop，唤醒，分发这一批新客户端的channel
     }
     else
     {
-        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if(errno == EMFILE) // accept fd达到上限
+        for(const std::pair<int, InetAddress> &item : accepted_)
         {
-            LOG_ERROR("%s:%s:%d sockfd reached limit:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+            if(newConnectionCallback_)
+            {
+                newConnectionCallback_(item.first, item.second);
+            }
+            else
+            {
+                ::close(item.first);
+            }
         }
     }
-}
\ No newline at end of file
+    accepted_.clear();
+}
+
+bool Acceptor::dropConnection()
+{
+    if(idleFd_ < 0)
+    {
+        return false;
+    }
+    // 让出预留的fd，把全连接队列头上的连接accept出来直接关掉，客户端会收到FIN，而不是一直挂在队列里
+    ::close(idleFd_);
+    int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if(connfd >= 0)
+    {
+        ::close(connfd);
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return connfd >= 0;
+}
@@ -3,17 +3,28 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
 
 #include <functional>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <stdint.h>
 
 class EventLoop;
-class InetAddress;
 
 
 class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+    // 一次可读事件accept到的所有连接 <connfd, peerAddr>
+    using AcceptedList = std::vector<std::pair<int, InetAddress>>;
+    using NewConnectionsCallback = std::function<void(const AcceptedList&)>;
+
+    // LT模式下每次可读事件最多accept的连接数
+    static const int KMaxAcceptsPerEvent = 16;
+
     Acceptor(EventLoop* loop, const InetAddress &listenAddr, bool reuseport);
     ~Acceptor();
 
@@ -21,16 +32,40 @@ public:
     {
         newConnectionCallback_ = cb;
     }
+    // 设置了批量回调，一次可读事件accept到的连接一起交给它，不再调用newConnectionCallback_
+    void setNewConnectionsCallback(const NewConnectionsCallback &cb)
+    {
+        newConnectionsCallback_ = cb;
+    }
+    // LT模式下每次可读事件最多accept多少个连接(ET模式总是accept到EAGAIN)
+    void setMaxAcceptsPerEvent(int n) { maxAcceptsPerEvent_ = n > 0 ? n : 1; }
 
     bool listenning() const { return listenning_; }
+    EventLoop* getLoop() const { return loop_; }
+
+    // 给SO_REUSEPORT组挂上按CPU选择socket的CBPF程序
+    void setReusePortCpuSteering(int groupSize) { acceptSocket_.setReusePortCpuSteering(groupSize); }
+
+    // 边缘触发模式下，每次可读事件都要accept到EAGAIN为止  需要在listen之前设置
+    void setEdgeTriggered(bool on) { acceptChannel_.setEdgeTriggered(on); }
 
     void listen();
+
+    // accept失败的次数(不算EAGAIN)  任何线程都可以读
+    uint64_t acceptErrors() const { return acceptErrors_.load(std::memory_order_relaxed); }
 private:
     void handleRead();
+    // fd用完了(EMFILE)，用预留的idleFd_接受一个连接再立刻关掉，让listenfd不再一直可读  没能丢掉连接返回false
+    bool dropConnection();
 
     EventLoop *loop_; // Acceptor用的就是用户定义的那个baseLoop, 也称为mainLoop
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCallback_;
+    NewConnectionsCallback newConnectionsCallback_;
     bool listenning_;
+    int maxAcceptsPerEvent_;
+    int idleFd_; // 预留的空闲fd，打开的是/dev/null
+    AcceptedList accepted_; // 这一次可读事件accept到的连接，复用内存
+    std::atomic<uint64_t> acceptErrors_;
 };
\ No newline at end of file
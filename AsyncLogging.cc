@@ -0,0 +1,179 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <chrono>
+#include <stdio.h>
+
+const size_t AsyncLogging::KBufferSize;
+const size_t AsyncLogging::KDefaultMaxBuffers;
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                        off_t rollSize,
+                        int flushInterval,
+                        size_t maxBuffers)
+    : flushInterval_(flushInterval)
+    , maxBuffers_(maxBuffers)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , running_(false)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging")
+    , currentBuffer_(new LogBuffer)
+    , nextBuffer_(new LogBuffer)
+    , dropped_(0)
+    , flushRequested_(0)
+    , flushCompleted_(0)
+    , totalDropped_(0)
+{
+    buffers_.reserve(maxBuffers_);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    stop();
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(!running_)
+        {
+            return;
+        }
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    if(buffers_.size() >= maxBuffers_)
+    {
+        // 后台线程跟不上，丢掉这一条，不再分配新的缓冲区
+        ++dropped_;
+        ++totalDropped_;
+        return;
+    }
+    buffers_.push_back(std::move(currentBuffer_));
+    if(nextBuffer_)
+    {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else
+    {
+        currentBuffer_.reset(new LogBuffer); // 备用的也用完了，很少发生
+    }
+    currentBuffer_->append(logline, len);
+    cond_.notify_one();
+}
+
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(!running_)
+    {
+        return;
+    }
+    int64_t request = ++flushRequested_;
+    cond_.notify_one();
+    flushCond_.wait(lock, [&]() { return flushCompleted_ >= request || !running_; });
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, flushInterval_);
+    // 后台线程自己的两块备用缓冲区，和前端交换，稳定状态下不再分配内存
+    BufferPtr newBuffer1(new LogBuffer);
+    BufferPtr newBuffer2(new LogBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(maxBuffers_ + 1);
+    bool running = true;
+    while(running)
+    {
+        int64_t dropped = 0;
+        int64_t flushRequest = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::seconds(flushInterval_), [&]() {
+                return !buffers_.empty() || flushRequested_ > flushCompleted_ || !running_;
+            });
+            running = running_;
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if(!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+            dropped = dropped_;
+            dropped_ = 0;
+            flushRequest = flushRequested_;
+        }
+
+        if(dropped > 0)
+        {
+            char buf[128];
+            int n = snprintf(buf, sizeof buf, "[ERROR]%s : AsyncLogging dropped %ld log messages, backend fell behind\n",
+                Timestamp::now().toString().c_str(), static_cast<long>(dropped));
+            output.append(buf, n);
+        }
+        for(const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // 留两块换回来做备用，其它的释放掉
+        if(buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+        if(!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if(!newBuffer2 && !buffersToWrite.empty())
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        else if(!newBuffer2)
+        {
+            newBuffer2.reset(new LogBuffer);
+        }
+        buffersToWrite.clear();
+        output.flush();
+
+        if(flushRequest > 0)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(flushRequest > flushCompleted_)
+            {
+                flushCompleted_ = flushRequest;
+                flushCond_.notify_all();
+            }
+        }
+    }
+    output.flush();
+    // 通知stop之后还在等的flush调用者
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushCompleted_ = flushRequested_;
+    flushCond_.notify_all();
+}
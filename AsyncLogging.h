@@ -0,0 +1,93 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * 异步日志  前端(写日志的各个线程)只把日志拷贝到内存缓冲区里，后台线程批量写到LogFile
+ * 双缓冲：前端写currentBuffer_，写满了放进buffers_，换上备用的nextBuffer_
+ * 后台线程每flushInterval秒(或者有写满的缓冲区的时候)醒来一次，把buffers_整个换出来再写文件，写文件的时候不持有锁
+ * 后台跟不上的时候，buffers_里最多攒maxBuffers个写满的缓冲区，再多的日志直接丢掉并计数，下一次写文件的时候记一条丢了多少条
+ * 前端永远不会因为磁盘慢而阻塞，内存占用也有上限
+ *
+ * AsyncLogging log("/var/log/server", 500 * 1024 * 1024);
+ * log.start();
+ * Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+ * Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log));
+*/
+class AsyncLogging : noncopyable
+{
+public:
+    static const size_t KBufferSize = 4 * 1024 * 1024;
+    static const size_t KDefaultMaxBuffers = 16;
+
+    AsyncLogging(const std::string &basename,
+                off_t rollSize,
+                int flushInterval = 3,
+                size_t maxBuffers = KDefaultMaxBuffers);
+    ~AsyncLogging();
+
+    // 可以在任何线程调用
+    void append(const char *logline, size_t len);
+    // 等后台线程把到目前为止append的日志都写进文件并fflush  LOG_FATAL退出进程之前调用
+    void flush();
+
+    void start();
+    // 写完剩下的日志再返回  析构的时候会调用
+    void stop();
+
+    // 因为后台跟不上丢掉的日志条数(累计)
+    int64_t droppedMessages() const { return totalDropped_; }
+
+private:
+    // 固定大小的缓冲区
+    class LogBuffer : noncopyable
+    {
+    public:
+        LogBuffer() : data_(new char[KBufferSize]), len_(0) {}
+
+        void append(const char *buf, size_t len)
+        {
+            ::memcpy(data_.get() + len_, buf, len);
+            len_ += len;
+        }
+        const char* data() const { return data_.get(); }
+        size_t length() const { return len_; }
+        size_t avail() const { return KBufferSize - len_; }
+        void reset() { len_ = 0; }
+    private:
+        std::unique_ptr<char[]> data_;
+        size_t len_;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+
+    const int flushInterval_;
+    const size_t maxBuffers_;
+    const std::string basename_;
+    const off_t rollSize_;
+    std::atomic_bool running_;
+    Thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_; // 唤醒后台线程
+    std::condition_variable flushCond_; // 通知flush的调用者
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_; // 写满了等着写文件的缓冲区
+    int64_t dropped_; // 上一次写文件之后丢掉的日志条数
+    int64_t flushRequested_; // flush()的请求序号
+    int64_t flushCompleted_; // 后台已经完成的flush序号
+    std::atomic<int64_t> totalDropped_;
+};
@@ -0,0 +1,268 @@
+#include "BinaryLog.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <stdio.h>
+#include <ctype.h>
+
+const size_t BinaryLogWriter::KMaxStringArg;
+
+// 一个参数的原始值
+struct BinaryLogArg
+{
+    int tag;
+    uint64_t bits; // KInt/KUint/KDouble/KPointer
+    std::string str; // KString
+};
+
+template <typename T>
+static T readRaw(const char *p)
+{
+    T v;
+    ::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+// 读一个参数，数据不完整返回nullptr  tag不认识的时候arg->tag置0
+static const char* readArg(const char *p, const char *end, BinaryLogArg *arg)
+{
+    if(p >= end)
+    {
+        return nullptr;
+    }
+    arg->tag = static_cast<uint8_t>(*p++);
+    switch(arg->tag)
+    {
+        case BinaryLogWriter::KInt:
+        case BinaryLogWriter::KUint:
+        case BinaryLogWriter::KDouble:
+        case BinaryLogWriter::KPointer:
+            if(end - p < 8)
+            {
+                return nullptr;
+            }
+            arg->bits = readRaw<uint64_t>(p);
+            return p + 8;
+        case BinaryLogWriter::KString:
+        {
+            if(end - p < 2)
+            {
+                return nullptr;
+            }
+            uint16_t len = readRaw<uint16_t>(p);
+            p += 2;
+            if(end - p < len)
+            {
+                return nullptr;
+            }
+            arg->str.assign(p, len);
+            return p + len;
+        }
+        default:
+            arg->tag = 0;
+            return p;
+    }
+}
+
+// 用一个参数格式化一个转换说明  spec是去掉了长度修饰符的"%...x"
+static void formatArg(const std::string &spec, char conversion, const BinaryLogArg &arg, std::string *out)
+{
+    char buf[1200];
+    int n = 0;
+    std::string fmt(spec);
+    switch(conversion)
+    {
+        case 'd': case 'i':
+            fmt.insert(fmt.size() - 1, "ll");
+            n = snprintf(buf, sizeof buf, fmt.c_str(), static_cast<long long>(arg.bits));
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            fmt.insert(fmt.size() - 1, "ll");
+            n = snprintf(buf, sizeof buf, fmt.c_str(), static_cast<unsigned long long>(arg.bits));
+            break;
+        case 'c':
+            n = snprintf(buf, sizeof buf, fmt.c_str(), static_cast<int>(arg.bits));
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        {
+            double d = 0;
+            if(arg.tag == BinaryLogWriter::KDouble)
+            {
+                ::memcpy(&d, &arg.bits, sizeof d);
+            }
+            n = snprintf(buf, sizeof buf, fmt.c_str(), d);
+            break;
+        }
+        case 's':
+            n = snprintf(buf, sizeof buf, fmt.c_str(), arg.tag == BinaryLogWriter::KString ? arg.str.c_str() : "(?)");
+            break;
+        case 'p':
+            n = snprintf(buf, sizeof buf, fmt.c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(arg.bits)));
+            break;
+        default:
+            out->append(spec);
+            return;
+    }
+    if(n > 0)
+    {
+        out->append(buf, static_cast<size_t>(n) < sizeof buf ? n : sizeof buf - 1);
+    }
+}
+
+void BinaryLogDecoder::formatRecord(const std::string &format, const char *args, const char *argsEnd, int argc, std::string *out)
+{
+    std::vector<BinaryLogArg> values(argc);
+    for(int i = 0;i < argc;i++)
+    {
+        args = readArg(args, argsEnd, &values[i]);
+    }
+
+    int next = 0;
+    size_t i = 0;
+    while(i < format.size())
+    {
+        char c = format[i];
+        if(c != '%')
+        {
+            out->push_back(c);
+            i++;
+            continue;
+        }
+        if(i + 1 < format.size() && format[i + 1] == '%')
+        {
+            out->push_back('%');
+            i += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion  长度修饰符去掉，按参数实际的类型重新加
+        std::string spec("%");
+        size_t j = i + 1;
+        while(j < format.size() && ::strchr("-+ #0", format[j]) != nullptr)
+        {
+            spec.push_back(format[j++]);
+        }
+        while(j < format.size() && (isdigit(static_cast<unsigned char>(format[j])) || format[j] == '.' || format[j] == '*'))
+        {
+            if(format[j] == '*') // 宽度/精度也是一个参数
+            {
+                char num[32];
+                snprintf(num, sizeof num, "%d", next < argc ? static_cast<int>(values[next++].bits) : 0);
+                spec.append(num);
+            }
+            else
+            {
+                spec.push_back(format[j]);
+            }
+            j++;
+        }
+        while(j < format.size() && ::strchr("hlLqjzt", format[j]) != nullptr)
+        {
+            j++;
+        }
+        if(j >= format.size())
+        {
+            out->append(format, i, std::string::npos);
+            return;
+        }
+        char conversion = format[j];
+        spec.push_back(conversion);
+        if(conversion == 'n')
+        {
+            next++;
+        }
+        else if(next < argc)
+        {
+            formatArg(spec, conversion, values[next++], out);
+        }
+        else
+        {
+            out->append(format, i, j + 1 - i); // 参数不够，原样输出
+        }
+        i = j + 1;
+    }
+}
+
+size_t BinaryLogDecoder::decode(const char *data, size_t len, std::string *out)
+{
+    const char *p = data;
+    const char *end = data + len;
+    while(p < end)
+    {
+        const char *record = p;
+        char kind = *p++;
+        if(kind == 'F')
+        {
+            if(end - p < 6)
+            {
+                return record - data;
+            }
+            uint32_t id = readRaw<uint32_t>(p);
+            uint16_t formatLen = readRaw<uint16_t>(p + 4);
+            p += 6;
+            if(end - p < formatLen)
+            {
+                return record - data;
+            }
+            formats_[id].assign(p, formatLen);
+            p += formatLen;
+        }
+        else if(kind == 'R')
+        {
+            if(end - p < 14)
+            {
+                return record - data;
+            }
+            uint32_t id = readRaw<uint32_t>(p);
+            int level = static_cast<uint8_t>(p[4]);
+            int64_t micros = readRaw<int64_t>(p + 5);
+            int argc = static_cast<uint8_t>(p[13]);
+            p += 14;
+
+            // 先确认参数都完整了
+            const char *args = p;
+            BinaryLogArg arg;
+            for(int i = 0;i < argc;i++)
+            {
+                p = readArg(p, end, &arg);
+                if(p == nullptr)
+                {
+                    return record - data;
+                }
+                if(arg.tag == 0)
+                {
+                    error_ = true;
+                    return record - data;
+                }
+            }
+
+            std::unordered_map<uint32_t, std::string>::const_iterator it = formats_.find(id);
+            out->append(Logger::levelName(level));
+            out->append(Timestamp(micros).toString());
+            out->append(" : ");
+            if(it == formats_.end())
+            {
+                char buf[64];
+                snprintf(buf, sizeof buf, "<unknown format id %u>", id);
+                out->append(buf);
+            }
+            else
+            {
+                formatRecord(it->second, args, p, argc, out);
+            }
+            // 和文本格式一样，去掉格式串自己带的换行，每条日志一行
+            while(!out->empty() && (out->back() == '\n' || out->back() == ' '))
+            {
+                out->pop_back();
+            }
+            out->push_back('\n');
+        }
+        else
+        {
+            error_ = true;
+            return record - data;
+        }
+    }
+    return len;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <unordered_map>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * 二进制日志格式  写日志的时候不做printf格式化，只记录格式串的id和参数的原始值，离线再用BinaryLogDecoder还原成文本
+ * 每个LOG_*调用点的格式串第一次使用的时候分配一个id，先输出一条格式串记录，之后的日志记录里只有id
+ * 所以解码要从第一个日志文件开始按顺序解  字节序是本机的，只能在同一种架构上解码
+ *
+ * 格式串记录: 'F' | u32 id | u16 len | 格式串
+ * 日志记录:   'R' | u32 id | u8 level | i64 微秒时间戳 | u8 参数个数 | 参数...
+ * 参数:       u8 tag | 8字节的整数/浮点数/指针 或者 u16 len + 字符串
+*/
+class BinaryLogWriter : noncopyable
+{
+public:
+    enum Tag { KInt = 1, KUint, KDouble, KString, KPointer };
+
+    static const size_t KMaxStringArg = 1024; // 字符串参数超过的部分截断
+
+    BinaryLogWriter(char *buf, size_t size)
+        : begin_(buf)
+        , cur_(buf)
+        , end_(buf + size)
+    {
+    }
+
+    size_t length() const { return cur_ - begin_; }
+    bool overflow() const { return cur_ > end_; }
+
+    void appendFormat(uint32_t id, const char *format)
+    {
+        size_t len = ::strlen(format);
+        if(len > 0xffff)
+        {
+            len = 0xffff;
+        }
+        putByte('F');
+        put(id);
+        put(static_cast<uint16_t>(len));
+        putBytes(format, len);
+    }
+
+    template <typename... Args>
+    void appendRecord(uint32_t id, int level, int64_t microSecondsSinceEpoch, const Args&... args)
+    {
+        putByte('R');
+        put(id);
+        putByte(static_cast<uint8_t>(level));
+        put(microSecondsSinceEpoch);
+        putByte(static_cast<uint8_t>(sizeof...(args)));
+        appendArgs(args...);
+    }
+
+private:
+    void appendArgs() {}
+
+    template <typename T, typename... Rest>
+    void appendArgs(const T &arg, const Rest&... rest)
+    {
+        appendArg(arg);
+        appendArgs(rest...);
+    }
+
+    // 有符号的整数和枚举按int64，无符号的整数按uint64
+    template <typename T>
+    typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) || std::is_enum<T>::value>::type
+    appendArg(T v)
+    {
+        putByte(KInt);
+        put(static_cast<int64_t>(v));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    appendArg(T v)
+    {
+        putByte(KUint);
+        put(static_cast<uint64_t>(v));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    appendArg(T v)
+    {
+        putByte(KDouble);
+        put(static_cast<double>(v));
+    }
+    // %p
+    template <typename T>
+    void appendArg(const T *p)
+    {
+        putByte(KPointer);
+        put(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)));
+    }
+    // %s  const char*/char*/char[N]
+    void appendArg(const char *s)
+    {
+        size_t len = s == nullptr ? 0 : ::strnlen(s, KMaxStringArg);
+        putByte(KString);
+        put(static_cast<uint16_t>(len));
+        putBytes(s, len);
+    }
+    void appendArg(char *s) { appendArg(static_cast<const char*>(s)); }
+
+    void putByte(uint8_t b)
+    {
+        if(cur_ < end_)
+        {
+            *cur_ = static_cast<char>(b);
+        }
+        ++cur_;
+    }
+    template <typename T>
+    void put(T v)
+    {
+        putBytes(&v, sizeof v);
+    }
+    void putBytes(const void *data, size_t len)
+    {
+        if(cur_ + len <= end_)
+        {
+            ::memcpy(cur_, data, len);
+        }
+        cur_ += len;
+    }
+
+    char *begin_;
+    char *cur_;
+    char *end_;
+};
+
+// 离线把二进制日志还原成和文本日志一样的格式
+class BinaryLogDecoder : noncopyable
+{
+public:
+    BinaryLogDecoder() : error_(false) {}
+
+    /**
+     * 解码data中完整的记录，文本追加到out，返回用掉的字节数
+     * 最后不完整的一条留给调用者和后面读到的数据拼起来再解
+     * 遇到无法识别的数据就停在那里，返回之前用掉的字节数，并设置error()
+    */
+    size_t decode(const char *data, size_t len, std::string *out);
+    bool error() const { return error_; }
+
+private:
+    void formatRecord(const std::string &format, const char *args, const char *argsEnd, int argc, std::string *out);
+
+    std::unordered_map<uint32_t, std::string> formats_;
+    bool error_;
+};
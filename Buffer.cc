@@ -3,16 +3,30 @@
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
+const size_t Buffer::KMaxReadSizeHint;
+
+// findCRLF的scanKey_  findAny的key是 分隔符个数<<56 | 分隔符，个数不会是0xff
+static const uint64_t KCRLFScanKey = 0xffULL << 56;
+
 /**
- * 从fd上读取数据  Poller工作在LT模式
+ * 从fd上读取数据
  * Buffer缓冲区是有大小的。但是从fd上读取数据的时候，是不知道tcp数据最终的大小
+ * 先按readSizeHint_预留可写空间，数据直接读进pool的内存块；放不下的部分读到栈上的extrabuf再append
+ * readSizeHint_跟着实际读到的数据量走：extrabuf被用到了就翻倍，连续读得很少就减半
 */
 /**
  * readv() 系统调用！！！！！！！！！
 */
-ssize_t Buffer::readFd(int fd, int* saveErrno)
+ssize_t Buffer::readFd(int fd, int* saveErrno, size_t maxBytes)
 {
-    char extrabuf[65536] = {0}; //栈上的内存空间  64k
+    char extrabuf[65536]; //栈上的内存空间  64k  不用清零，readv写了多少才会拷贝多少
+    size_t hint = readSizeHint_;
+    if(maxBytes > 0 && hint > maxBytes)
+    {
+        hint = maxBytes;
+    }
+    ensureWriteableBytes(hint); // 数据取空的时候内存块已经还给pool了，这里重新从pool拿一块
+
     struct iovec vec[2];
     const size_t writable = writeableBytes(); // Buffer底层缓冲区剩余的可写空间大小
     vec[0].iov_base = begin() + writerIndex_;
@@ -21,23 +35,39 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
     vec[1].iov_base = extrabuf;
     vec[1].iov_len = sizeof extrabuf;
 
-    const int iovcnt = (writeable < sizeof extrabuf) ? 2 : 1;
-    const ssize_t n = ::readv(fd, &vec, iovcnt);
+    int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    if(maxBytes > 0) // 读预算
+    {
+        if(writable >= maxBytes)
+        {
+            vec[0].iov_len = maxBytes;
+            iovcnt = 1;
+        }
+        else
+        {
+            vec[1].iov_len = std::min(sizeof extrabuf, maxBytes - writable);
+        }
+    }
+    const ssize_t n = ::readv(fd, vec, iovcnt);
     if(n < 0)
     {
         *saveErrno = errno;
+        return n;
     }
-    else if(n <= writeable) // Buffer可写缓冲区够放读出来的数据
+    if(static_cast<size_t>(n) <= writable) // Buffer可写缓冲区够放读出来的数据
     {
         writerIndex_ += n;
+        if(static_cast<size_t>(n) < readSizeHint_ / 4 && readSizeHint_ > initialSize_)
+        {
+            readSizeHint_ = std::max(readSizeHint_ / 2, initialSize_);
+        }
     }
     else // extrabuf中也写入了数据
     {
-        writerIndex_ = buffer_.size();
+        writerIndex_ = capacity_;
         append(extrabuf, n-writable);
+        readSizeHint_ = std::min(readSizeHint_ * 2, KMaxReadSizeHint);
     }
-
-    *saveErrno = errno;
     return n;
 }
 
@@ -50,4 +80,56 @@ ssize_t Buffer::writeFd(int fd, int* saveErrno)
         *saveErrno = errno;
     }
     return n;
-}
\ No newline at end of file
+}
+const char* Buffer::scanDone(uint64_t key, const char *found, size_t overlap)
+{
+    scanKey_ = key;
+    if(found != nullptr)
+    {
+        scanned_ = found - peek(); // 没取走之前再找，直接从匹配的位置开始
+    }
+    else
+    {
+        size_t readable = readableBytes();
+        scanned_ = readable > overlap ? readable - overlap : 0;
+    }
+    return found;
+}
+
+const char* Buffer::findCRLF()
+{
+    if(readableBytes() == 0)
+    {
+        return nullptr;
+    }
+    const char *found = ByteScan::findCRLF(scanStart(KCRLFScanKey), beginWrite());
+    return scanDone(KCRLFScanKey, found, 1); // 末尾的'\r'可能和下一次收到的'\n'组成CRLF
+}
+
+const char* Buffer::findByte(char c)
+{
+    return findAny(&c, 1);
+}
+
+const char* Buffer::findAny(const char *delimiters, size_t numDelimiters)
+{
+    if(readableBytes() == 0)
+    {
+        return nullptr;
+    }
+    // 不超过7个分隔符的查找可以记住扫描位置
+    uint64_t key = 0;
+    if(numDelimiters <= 7)
+    {
+        key = static_cast<uint64_t>(numDelimiters) << 56;
+        for(size_t i = 0;i < numDelimiters;i++)
+        {
+            key |= static_cast<uint64_t>(static_cast<uint8_t>(delimiters[i])) << (i * 8);
+        }
+    }
+    const char *begin = scanStart(key);
+    const char *found = numDelimiters == 1
+        ? ByteScan::findByte(begin, beginWrite(), delimiters[0])
+        : ByteScan::findAny(begin, beginWrite(), delimiters, numDelimiters);
+    return scanDone(key, found, 0);
+}
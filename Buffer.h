@@ -1,21 +1,87 @@
 #pragma once
 
+#include "BufferPool.h"
+#include "ByteScan.h"
+
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+#include <sys/types.h>
 
-// 网络库底层的缓冲器类型定义
+/**
+ * 网络库底层的缓冲器类型定义
+ * 内存块从当前线程EventLoop的BufferPool里分配，第一次写入的时候才分配(空闲的连接不占内存)
+ * 数据全部取走以后，把内存块还给pool；空间不够的时候按2倍扩容
+*/
 class Buffer
 {
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    static const size_t KMaxReadSizeHint = 128 * 1024; // readFd预留的可写空间的上限
 
     explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + kInitialSize)
+        : data_(nullptr)
+        , capacity_(0)
+        , initialSize_(initialSize)
+        , readSizeHint_(initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
+        , scanned_(0)
+        , scanKey_(0)
         {}
+    ~Buffer()
+    {
+        BufferPool::deallocate(data_, capacity_);
+    }
+
+    Buffer(const Buffer &rhs)
+        : data_(nullptr)
+        , capacity_(0)
+        , initialSize_(rhs.initialSize_)
+        , readSizeHint_(rhs.initialSize_)
+        , readerIndex_(kCheapPrepend)
+        , writerIndex_(kCheapPrepend)
+        , scanned_(0)
+        , scanKey_(0)
+    {
+        append(rhs.peek(), rhs.readableBytes());
+    }
+    Buffer(Buffer &&rhs)
+        : data_(rhs.data_)
+        , capacity_(rhs.capacity_)
+        , initialSize_(rhs.initialSize_)
+        , readSizeHint_(rhs.readSizeHint_)
+        , readerIndex_(rhs.readerIndex_)
+        , writerIndex_(rhs.writerIndex_)
+        , scanned_(rhs.scanned_)
+        , scanKey_(rhs.scanKey_)
+    {
+        rhs.data_ = nullptr;
+        rhs.capacity_ = 0;
+        rhs.readerIndex_ = rhs.writerIndex_ = kCheapPrepend;
+        rhs.scanned_ = 0;
+    }
+    Buffer& operator=(Buffer rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    void swap(Buffer &rhs)
+    {
+        std::swap(data_, rhs.data_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(initialSize_, rhs.initialSize_);
+        std::swap(readSizeHint_, rhs.readSizeHint_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(scanned_, rhs.scanned_);
+        std::swap(scanKey_, rhs.scanKey_);
+    }
 
     size_t readableBytes() const
     {
@@ -24,9 +90,12 @@ public:
 
     size_t writeableBytes() const
     {
-        return buffer_.size() - writerIndex_;
+        return capacity_ > writerIndex_ ? capacity_ - writerIndex_ : 0; // 还没有分配内存的时候capacity_是0
     }
 
+    // 当前占用的内存块大小
+    size_t capacity() const { return capacity_; }
+
     size_t prependableBytes() const
     {
         return readerIndex_;
@@ -45,6 +114,7 @@ public:
         {
             // 应用只读取了可读缓冲区数据的一部分,就是len,还剩下readerIndex_+len -> writerIndex_
             readerIndex_ += len;
+            scanned_ = scanned_ > len ? scanned_ - len : 0;
         }
         else  // len == readableBytes()
         {
@@ -55,6 +125,14 @@ public:
     void retrieveAll()
     {
         readerIndex_ = writerIndex_ = kCheapPrepend;
+        scanned_ = 0;
+        // 在loop线程里数据取空了，内存块还给pool，下一次写入的时候再分配
+        if(data_ != nullptr && BufferPool::threadPool() != nullptr)
+        {
+            BufferPool::deallocate(data_, capacity_);
+            data_ = nullptr;
+            capacity_ = 0;
+        }
     }
 
     // 把onMessage函数上报的Buffer数据，转成string类型的数据返回
@@ -67,8 +145,58 @@ public:
     {
         std::string result(peek(), len);
         retrieve(len); // 上面一句把缓冲区中可读的数据，已经读取出来，这里要对缓冲区进行复位操作
-        return len;
+        return result;
+    }
+
+    /**
+     * 在可读数据中查找分隔符，返回第一个匹配的位置，没找到返回nullptr  底层是ByteScan(SSE2/AVX2)，不拷贝数据
+     * 没找到的时候记住已经扫描过的长度，之后只追加了数据(半包)再做同样的查找，从上次停下的地方接着扫
+    */
+    const char* findCRLF(); // "\r\n"，返回'\r'的位置
+    const char* findEOL() { return findByte('\n'); }
+    const char* findByte(char c);
+    const char* findAny(const char *delimiters, size_t numDelimiters);
+
+    /**
+     * 网络字节序(大端)的整数
+     * append写到末尾；peek只看不取，read读出来并取走，调用之前要保证readableBytes()够；
+     * prepend写到可读数据的前面，用的是kCheapPrepend预留的空间，给已经写好的消息体加长度头不用挪动数据
+     * (前面的空间不够的时候才把可读数据往后挪)
+    */
+    void appendInt64(int64_t x) { int64_t be = htobe64(x); append(reinterpret_cast<const char*>(&be), sizeof be); }
+    void appendInt32(int32_t x) { int32_t be = htobe32(x); append(reinterpret_cast<const char*>(&be), sizeof be); }
+    void appendInt16(int16_t x) { int16_t be = htobe16(x); append(reinterpret_cast<const char*>(&be), sizeof be); }
+    void appendInt8(int8_t x) { append(reinterpret_cast<const char*>(&x), sizeof x); }
+
+    int64_t peekInt64() const { int64_t be; ::memcpy(&be, peek(), sizeof be); return be64toh(be); }
+    int32_t peekInt32() const { int32_t be; ::memcpy(&be, peek(), sizeof be); return be32toh(be); }
+    int16_t peekInt16() const { int16_t be; ::memcpy(&be, peek(), sizeof be); return be16toh(be); }
+    int8_t peekInt8() const { return *peek(); }
+
+    int64_t readInt64() { int64_t x = peekInt64(); retrieve(sizeof x); return x; }
+    int32_t readInt32() { int32_t x = peekInt32(); retrieve(sizeof x); return x; }
+    int16_t readInt16() { int16_t x = peekInt16(); retrieve(sizeof x); return x; }
+    int8_t readInt8() { int8_t x = peekInt8(); retrieve(sizeof x); return x; }
+
+    // 把[data, data+len]放到可读数据的前面
+    void prepend(const void *data, size_t len)
+    {
+        if(data_ == nullptr) // 空的Buffer还没有分配内存块
+        {
+            data_ = BufferPool::allocate(kCheapPrepend + initialSize_, &capacity_);
+        }
+        if(prependableBytes() < len) // 前面的空间不够，readerIndex_ -= len会回绕
+        {
+            makePrependSpace(len);
+        }
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+        scanned_ = 0; // 前面多出来的数据还没有扫描过
     }
+    void prependInt64(int64_t x) { int64_t be = htobe64(x); prepend(&be, sizeof be); }
+    void prependInt32(int32_t x) { int32_t be = htobe32(x); prepend(&be, sizeof be); }
+    void prependInt16(int16_t x) { int16_t be = htobe16(x); prepend(&be, sizeof be); }
+    void prependInt8(int8_t x) { prepend(&x, sizeof x); }
 
     // buffer_.size() - writerIndex_
     void ensureWriteableBytes(size_t len)
@@ -98,29 +226,55 @@ public:
     }
 
     // 从fd上读取数据
-    ssize_t readFd(int fd, int* saveErrno);
+    // 从fd上读取数据  maxBytes > 0 时这一次最多读maxBytes字节(loop的读预算)
+    ssize_t readFd(int fd, int* saveErrno, size_t maxBytes = 0);
+    // 下一次readFd预留的可写空间，根据最近几次读到的数据量自适应调整
+    size_t readSizeHint() const { return readSizeHint_; }
     // 通过fd发送数据
     ssize_t writeFd(int fd, int* saveErrno);
 private:
+    // 同样的查找(scanKey_相同)从上次扫描到的位置开始
+    const char* scanStart(uint64_t key) const
+    {
+        return peek() + (key != 0 && key == scanKey_ ? scanned_ : 0);
+    }
+    // 记住这次查找扫描到的位置  overlap: 末尾可能是分隔符前半部分的字节数，下次要重新扫
+    const char* scanDone(uint64_t key, const char *found, size_t overlap);
+
     char* begin()
     {
-        return &*buffer_.begin();
+        return data_;
     }
 
-    const char* begin()
+    const char* begin() const
     {
-        return &*buffer_.begin();
+        return data_;
     }
 
     void makeSpace(size_t len)
     {
         if(writeableBytes() + prependableBytes() < len + kCheapPrepend)
         {
-            buffer_.resize(writerIndex_ + len);
+            // 按2倍扩容，连续写入大的数据不会每次都重新分配、拷贝
+            size_t readable = readableBytes();
+            size_t newSize = std::max(kCheapPrepend + std::max(readable + len, initialSize_), capacity_ * 2);
+            size_t newCapacity = 0;
+            char *newData = BufferPool::allocate(newSize, &newCapacity);
+            if(data_ != nullptr)
+            {
+                std::copy(begin() + readerIndex_,
+                          begin() + writerIndex_,
+                          newData + kCheapPrepend);
+                BufferPool::deallocate(data_, capacity_);
+            }
+            data_ = newData;
+            capacity_ = newCapacity;
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = readerIndex_ + readable;
         }
         else
         {
-            size_t readable - readableBytes();
+            size_t readable = readableBytes();
             std::copy(begin() + readerIndex_,
                       begin() + writerIndex_,
                       begin() + kCheapPrepend);
@@ -129,7 +283,39 @@ private:
         }
     }
 
-    std::vector<char> buffer_;
+    // 把可读数据往后挪，让前面至少空出len + kCheapPrepend字节
+    void makePrependSpace(size_t len)
+    {
+        size_t readable = readableBytes();
+        size_t front = len + kCheapPrepend;
+        if(front + readable <= capacity_)
+        {
+            // 往后挪，源区间和目标区间可能重叠，从后往前拷贝
+            std::copy_backward(begin() + readerIndex_,
+                               begin() + writerIndex_,
+                               begin() + front + readable);
+        }
+        else
+        {
+            size_t newCapacity = 0;
+            char *newData = BufferPool::allocate(std::max(front + readable, capacity_ * 2), &newCapacity);
+            std::copy(begin() + readerIndex_,
+                      begin() + writerIndex_,
+                      newData + front);
+            BufferPool::deallocate(data_, capacity_);
+            data_ = newData;
+            capacity_ = newCapacity;
+        }
+        readerIndex_ = front;
+        writerIndex_ = readerIndex_ + readable;
+    }
+
+    char *data_; // 从BufferPool分配的内存块，没有分配的时候是nullptr
+    size_t capacity_;
+    size_t initialSize_; // 第一次分配的最小可写空间
+    size_t readSizeHint_; // readFd之前至少预留这么多可写空间，让数据直接读进pool的内存块
     size_t readerIndex_;
     size_t writerIndex_;
+    size_t scanned_; // 上一次查找没找到的时候，已经扫描过的可读数据的长度
+    uint64_t scanKey_; // 上一次查找的分隔符，0表示不能接着扫
 };
\ No newline at end of file
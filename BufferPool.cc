@@ -0,0 +1,137 @@
+#include "BufferPool.h"
+#include "Logger.h"
+
+#include <atomic>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+const size_t BufferPool::KMinBlockSize;
+const size_t BufferPool::KMaxBlockSize;
+const size_t BufferPool::KMaxCachedBytes;
+
+// 当前线程的EventLoop的pool
+__thread BufferPool *t_bufferPool = nullptr;
+
+static std::atomic_bool g_hugePages(false);
+
+static const size_t KHugePageSize = 2 * 1024 * 1024;
+
+// size所在的大小等级，超过KMaxBlockSize返回-1
+static int sizeClassOf(size_t size)
+{
+    int sizeClass = 0;
+    size_t blockSize = BufferPool::KMinBlockSize;
+    while(blockSize < size)
+    {
+        blockSize <<= 1;
+        ++sizeClass;
+    }
+    return sizeClass < BufferPool::KNumClasses ? sizeClass : -1;
+}
+
+static char* mallocBlock(size_t size)
+{
+    if(size >= KHugePageSize && g_hugePages.load(std::memory_order_relaxed))
+    {
+        void *block = nullptr;
+        if(::posix_memalign(&block, KHugePageSize, size) == 0)
+        {
+            ::madvise(block, size, MADV_HUGEPAGE);
+            return static_cast<char*>(block);
+        }
+    }
+    char *block = static_cast<char*>(::malloc(size));
+    if(block == nullptr)
+    {
+        LOG_FATAL("BufferPool malloc %lu bytes failed \n", size);
+    }
+    return block;
+}
+
+BufferPool::BufferPool()
+    : cachedBytes_(0)
+    {}
+
+BufferPool::~BufferPool()
+{
+    for(int i = 0;i < KNumClasses;i++)
+    {
+        for(char *block : freeLists_[i])
+        {
+            ::free(block);
+        }
+    }
+}
+
+BufferPool* BufferPool::threadPool()
+{
+    return t_bufferPool;
+}
+
+void BufferPool::setThreadPool(BufferPool *pool)
+{
+    t_bufferPool = pool;
+}
+
+void BufferPool::setHugePages(bool on)
+{
+    g_hugePages = on;
+}
+
+char* BufferPool::allocate(size_t size, size_t *capacity)
+{
+    int sizeClass = sizeClassOf(size);
+    if(sizeClass < 0) // 太大的块不进pool
+    {
+        *capacity = size;
+        return mallocBlock(size);
+    }
+
+    *capacity = KMinBlockSize << sizeClass;
+    if(t_bufferPool != nullptr)
+    {
+        return t_bufferPool->get(sizeClass);
+    }
+    return mallocBlock(*capacity);
+}
+
+void BufferPool::deallocate(char *block, size_t capacity)
+{
+    if(block == nullptr)
+    {
+        return;
+    }
+    int sizeClass = sizeClassOf(capacity);
+    if(t_bufferPool != nullptr && sizeClass >= 0)
+    {
+        t_bufferPool->put(sizeClass, block);
+        return;
+    }
+    ::free(block);
+}
+
+char* BufferPool::get(int sizeClass)
+{
+    size_t blockSize = KMinBlockSize << sizeClass;
+    std::vector<char*> &freeList = freeLists_[sizeClass];
+    if(freeList.empty())
+    {
+        return mallocBlock(blockSize);
+    }
+    char *block = freeList.back();
+    freeList.pop_back();
+    cachedBytes_ -= blockSize;
+    return block;
+}
+
+void BufferPool::put(int sizeClass, char *block)
+{
+    size_t blockSize = KMinBlockSize << sizeClass;
+    if(cachedBytes_ + blockSize > KMaxCachedBytes)
+    {
+        ::free(block);
+        return;
+    }
+    freeLists_[sizeClass].push_back(block);
+    cachedBytes_ += blockSize;
+}
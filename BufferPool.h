@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <vector>
+#include <stddef.h>
+
+/**
+ * 缓冲区内存块池  每个EventLoop一个，Buffer/ChainBuffer通过当前线程的EventLoop的pool分配内存块
+ * 按2的幂分成几个大小等级(KMinBlockSize ~ KMaxBlockSize)，每个等级一个空闲链表，归还的块下次直接复用
+ * 稳态下收发消息不再调用malloc；空闲链表总大小不超过KMaxCachedBytes，多出来的块直接free，RSS是可预期的
+ *
+ * 所有的块都是malloc(或者posix_memalign)出来的，所以在哪个线程归还都可以：
+ * 当前线程有EventLoop就放进它的pool，没有就直接free
+*/
+class BufferPool : noncopyable
+{
+public:
+    static const size_t KMinBlockSize = 2 * 1024;
+    static const size_t KMaxBlockSize = 4 * 1024 * 1024;
+    static const int KNumClasses = 12; // 2KB, 4KB, ... 4MB
+    static const size_t KMaxCachedBytes = 64 * 1024 * 1024; // 每个pool最多缓存的空闲内存
+
+    BufferPool();
+    ~BufferPool();
+
+    // 当前线程的EventLoop的pool，没有返回nullptr
+    static BufferPool* threadPool();
+    // EventLoop构造/析构的时候设置
+    static void setThreadPool(BufferPool *pool);
+
+    // 分配至少size字节的块，*capacity返回块的实际大小  优先用当前线程的pool
+    static char* allocate(size_t size, size_t *capacity);
+    // 归还allocate分配的块，capacity必须是allocate返回的大小
+    static void deallocate(char *block, size_t capacity);
+
+    // 不小于2MB的块按2MB对齐分配，并且madvise(MADV_HUGEPAGE)，减少TLB miss  需要在分配之前设置
+    static void setHugePages(bool on);
+
+    size_t cachedBytes() const { return cachedBytes_; }
+private:
+    char* get(int sizeClass);
+    void put(int sizeClass, char *block);
+
+    std::vector<char*> freeLists_[KNumClasses];
+    size_t cachedBytes_;
+};
@@ -0,0 +1,419 @@
+#include "ByteScan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+const size_t ByteScan::KMaxVectorDelimiters;
+
+struct ByteScanKernels
+{
+    const char* (*findAny)(const char *begin, const char *end, const char *delimiters, size_t numDelimiters);
+    const char* (*findCRLF)(const char *begin, const char *end);
+    ByteScan::Implementation impl;
+    const char *name;
+};
+
+/* ---------------- 标量实现 ---------------- */
+
+static const char* findAnyScalar(const char *begin, const char *end, const char *delimiters, size_t numDelimiters)
+{
+    bool isDelimiter[256];
+    ::memset(isDelimiter, 0, sizeof isDelimiter);
+    for(size_t i = 0;i < numDelimiters;i++)
+    {
+        isDelimiter[static_cast<uint8_t>(delimiters[i])] = true;
+    }
+    for(const char *p = begin;p < end;++p)
+    {
+        if(isDelimiter[static_cast<uint8_t>(*p)])
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+static const char* findCRLFScalar(const char *begin, const char *end)
+{
+    for(const char *p = begin;p + 1 < end;++p)
+    {
+        if(p[0] == '\r' && p[1] == '\n')
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+static const ByteScanKernels KScalarKernels = { findAnyScalar, findCRLFScalar, ByteScan::KScalar, "scalar" };
+
+#ifdef MUDUO_BYTESCAN_X86
+
+/**
+ * 向量化实现的框架  Matcher(p)返回从p开始的一个向量中每个位置是否匹配(匹配的字节是0xff)
+ * 1. 主循环一次比较4个向量，4个结果或在一起只判断一次，循环里基本没有分支
+ * 2. 剩下不满4个向量的一个一个比较
+ * 3. 最后不满一个向量的尾巴，退回到end - 向量宽度再加载一次(和前面的重叠)，把已经检查过的位置移出去
+ * Matcher::KExtra: 判断一个位置要往后多看几个字节(CRLF是1)  数据比一个向量还短的时候用标量实现
+*/
+
+/* ---------------- SSE2  一次16字节 ---------------- */
+
+template <size_t N>
+struct AnyMatcherSSE2
+{
+    static const size_t KExtra = 0;
+
+    __attribute__((target("sse2")))
+    explicit AnyMatcherSSE2(const char *delimiters)
+        : delimiters_(delimiters)
+    {
+        for(size_t i = 0;i < N;i++)
+        {
+            needles_[i] = _mm_set1_epi8(delimiters[i]);
+        }
+    }
+
+    __attribute__((target("sse2")))
+    __m128i operator()(const char *p) const
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_cmpeq_epi8(block, needles_[0]);
+        for(size_t i = 1;i < N;i++)
+        {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, needles_[i]));
+        }
+        return hit;
+    }
+
+    const char* scalar(const char *begin, const char *end) const
+    {
+        return findAnyScalar(begin, end, delimiters_, N);
+    }
+
+    const char *delimiters_;
+    __m128i needles_[N];
+};
+
+// p[i] == '\r' && p[i+1] == '\n'：错开一个字节再加载一次，两次比较的结果按位与
+struct CRLFMatcherSSE2
+{
+    static const size_t KExtra = 1;
+
+    __attribute__((target("sse2")))
+    CRLFMatcherSSE2()
+        : cr_(_mm_set1_epi8('\r'))
+        , lf_(_mm_set1_epi8('\n'))
+        {}
+
+    __attribute__((target("sse2")))
+    __m128i operator()(const char *p) const
+    {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        return _mm_and_si128(_mm_cmpeq_epi8(first, cr_), _mm_cmpeq_epi8(second, lf_));
+    }
+
+    const char* scalar(const char *begin, const char *end) const
+    {
+        return findCRLFScalar(begin, end);
+    }
+
+    __m128i cr_;
+    __m128i lf_;
+};
+
+template <typename Matcher>
+__attribute__((target("sse2")))
+static const char* scanSSE2(const char *begin, const char *end, const Matcher &match)
+{
+    const size_t KWidth = 16;
+    const size_t span = KWidth + Matcher::KExtra; // 比较一个向量需要的字节数
+    if(static_cast<size_t>(end - begin) < span)
+    {
+        return match.scalar(begin, end);
+    }
+
+    const char *p = begin;
+    for(;p + 3 * KWidth + span <= end;p += 4 * KWidth)
+    {
+        __m128i m0 = match(p);
+        __m128i m1 = match(p + KWidth);
+        __m128i m2 = match(p + 2 * KWidth);
+        __m128i m3 = match(p + 3 * KWidth);
+        if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3))) != 0)
+        {
+            uint64_t mask = static_cast<uint64_t>(_mm_movemask_epi8(m0))
+                | static_cast<uint64_t>(_mm_movemask_epi8(m1)) << 16
+                | static_cast<uint64_t>(_mm_movemask_epi8(m2)) << 32
+                | static_cast<uint64_t>(_mm_movemask_epi8(m3)) << 48;
+            return p + __builtin_ctzll(mask);
+        }
+    }
+    for(;p + span <= end;p += KWidth)
+    {
+        unsigned mask = _mm_movemask_epi8(match(p));
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    if(p + Matcher::KExtra < end)
+    {
+        const char *last = end - span;
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match(last))) >> (p - last);
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return nullptr;
+}
+
+__attribute__((target("sse2")))
+static const char* findAnySSE2(const char *begin, const char *end, const char *delimiters, size_t numDelimiters)
+{
+    switch(numDelimiters) // 分隔符个数是编译期常量，比较的循环可以完全展开
+    {
+        case 2: return scanSSE2(begin, end, AnyMatcherSSE2<2>(delimiters));
+        case 3: return scanSSE2(begin, end, AnyMatcherSSE2<3>(delimiters));
+        case 4: return scanSSE2(begin, end, AnyMatcherSSE2<4>(delimiters));
+        case 5: return scanSSE2(begin, end, AnyMatcherSSE2<5>(delimiters));
+        case 6: return scanSSE2(begin, end, AnyMatcherSSE2<6>(delimiters));
+        case 7: return scanSSE2(begin, end, AnyMatcherSSE2<7>(delimiters));
+        case 8: return scanSSE2(begin, end, AnyMatcherSSE2<8>(delimiters));
+        default: return findAnyScalar(begin, end, delimiters, numDelimiters);
+    }
+}
+
+__attribute__((target("sse2")))
+static const char* findCRLFSSE2(const char *begin, const char *end)
+{
+    return scanSSE2(begin, end, CRLFMatcherSSE2());
+}
+
+static const ByteScanKernels KSSE2Kernels = { findAnySSE2, findCRLFSSE2, ByteScan::KSSE2, "sse2" };
+
+/* ---------------- AVX2  一次32字节 ---------------- */
+// 只调用AVX2和标量的代码，不回到SSE2的实现，避免AVX/SSE切换的开销
+
+template <size_t N>
+struct AnyMatcherAVX2
+{
+    static const size_t KExtra = 0;
+
+    __attribute__((target("avx2")))
+    explicit AnyMatcherAVX2(const char *delimiters)
+        : delimiters_(delimiters)
+    {
+        for(size_t i = 0;i < N;i++)
+        {
+            needles_[i] = _mm256_set1_epi8(delimiters[i]);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    __m256i operator()(const char *p) const
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_cmpeq_epi8(block, needles_[0]);
+        for(size_t i = 1;i < N;i++)
+        {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, needles_[i]));
+        }
+        return hit;
+    }
+
+    const char* scalar(const char *begin, const char *end) const
+    {
+        return findAnyScalar(begin, end, delimiters_, N);
+    }
+
+    const char *delimiters_;
+    __m256i needles_[N];
+};
+
+struct CRLFMatcherAVX2
+{
+    static const size_t KExtra = 1;
+
+    __attribute__((target("avx2")))
+    CRLFMatcherAVX2()
+        : cr_(_mm256_set1_epi8('\r'))
+        , lf_(_mm256_set1_epi8('\n'))
+        {}
+
+    __attribute__((target("avx2")))
+    __m256i operator()(const char *p) const
+    {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        return _mm256_and_si256(_mm256_cmpeq_epi8(first, cr_), _mm256_cmpeq_epi8(second, lf_));
+    }
+
+    const char* scalar(const char *begin, const char *end) const
+    {
+        return findCRLFScalar(begin, end);
+    }
+
+    __m256i cr_;
+    __m256i lf_;
+};
+
+template <typename Matcher>
+__attribute__((target("avx2")))
+static const char* scanAVX2(const char *begin, const char *end, const Matcher &match)
+{
+    const size_t KWidth = 32;
+    const size_t span = KWidth + Matcher::KExtra;
+    if(static_cast<size_t>(end - begin) < span)
+    {
+        return match.scalar(begin, end);
+    }
+
+    const char *p = begin;
+    for(;p + 3 * KWidth + span <= end;p += 4 * KWidth)
+    {
+        __m256i m0 = match(p);
+        __m256i m1 = match(p + KWidth);
+        __m256i m2 = match(p + 2 * KWidth);
+        __m256i m3 = match(p + 3 * KWidth);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(m0, m1), _mm256_or_si256(m2, m3));
+        if(!_mm256_testz_si256(any, any))
+        {
+            uint64_t low = static_cast<uint32_t>(_mm256_movemask_epi8(m0))
+                | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(m1))) << 32;
+            if(low != 0)
+            {
+                return p + __builtin_ctzll(low);
+            }
+            uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(m2))
+                | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(m3))) << 32;
+            return p + 2 * KWidth + __builtin_ctzll(high);
+        }
+    }
+    for(;p + span <= end;p += KWidth)
+    {
+        unsigned mask = _mm256_movemask_epi8(match(p));
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    if(p + Matcher::KExtra < end)
+    {
+        const char *last = end - span;
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(match(last))) >> (p - last);
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return nullptr;
+}
+
+__attribute__((target("avx2")))
+static const char* findAnyAVX2(const char *begin, const char *end, const char *delimiters, size_t numDelimiters)
+{
+    switch(numDelimiters)
+    {
+        case 2: return scanAVX2(begin, end, AnyMatcherAVX2<2>(delimiters));
+        case 3: return scanAVX2(begin, end, AnyMatcherAVX2<3>(delimiters));
+        case 4: return scanAVX2(begin, end, AnyMatcherAVX2<4>(delimiters));
+        case 5: return scanAVX2(begin, end, AnyMatcherAVX2<5>(delimiters));
+        case 6: return scanAVX2(begin, end, AnyMatcherAVX2<6>(delimiters));
+        case 7: return scanAVX2(begin, end, AnyMatcherAVX2<7>(delimiters));
+        case 8: return scanAVX2(begin, end, AnyMatcherAVX2<8>(delimiters));
+        default: return findAnyScalar(begin, end, delimiters, numDelimiters);
+    }
+}
+
+__attribute__((target("avx2")))
+static const char* findCRLFAVX2(const char *begin, const char *end)
+{
+    return scanAVX2(begin, end, CRLFMatcherAVX2());
+}
+
+static const ByteScanKernels KAVX2Kernels = { findAnyAVX2, findCRLFAVX2, ByteScan::KAVX2, "avx2" };
+
+#endif // MUDUO_BYTESCAN_X86
+
+static const ByteScanKernels* detectKernels()
+{
+#ifdef MUDUO_BYTESCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return &KAVX2Kernels;
+    }
+    if(__builtin_cpu_supports("sse2"))
+    {
+        return &KSSE2Kernels;
+    }
+#endif
+    return &KScalarKernels;
+}
+
+// 动态库加载的时候选好
+static const ByteScanKernels *g_kernels = detectKernels();
+
+const char* ByteScan::findByte(const char *begin, const char *end, char c)
+{
+    return static_cast<const char*>(::memchr(begin, c, end - begin));
+}
+
+const char* ByteScan::findAny(const char *begin, const char *end, const char *delimiters, size_t numDelimiters)
+{
+    if(numDelimiters == 0)
+    {
+        return nullptr;
+    }
+    if(numDelimiters == 1)
+    {
+        return findByte(begin, end, delimiters[0]);
+    }
+    return g_kernels->findAny(begin, end, delimiters, numDelimiters);
+}
+
+const char* ByteScan::findCRLF(const char *begin, const char *end)
+{
+    return g_kernels->findCRLF(begin, end);
+}
+
+ByteScan::Implementation ByteScan::implementation()
+{
+    return g_kernels->impl;
+}
+
+const char* ByteScan::implementationName()
+{
+    return g_kernels->name;
+}
+
+bool ByteScan::setImplementation(Implementation impl)
+{
+    if(impl == KScalar)
+    {
+        g_kernels = &KScalarKernels;
+        return true;
+    }
+#ifdef MUDUO_BYTESCAN_X86
+    __builtin_cpu_init();
+    if(impl == KSSE2 && __builtin_cpu_supports("sse2"))
+    {
+        g_kernels = &KSSE2Kernels;
+        return true;
+    }
+    if(impl == KAVX2 && __builtin_cpu_supports("avx2"))
+    {
+        g_kernels = &KAVX2Kernels;
+        return true;
+    }
+#endif
+    return false;
+}
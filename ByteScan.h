@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * 在一段内存里查找分隔符  Buffer::findCRLF/findEOL/findByte/findAny的底层实现
+ * findCRLF/findAny在x86上有SSE2/AVX2两套向量化的实现，一次比较16/32字节，动态库加载的时候按CPU支持的指令集选最快的一套
+ * 其它平台(或者强制setImplementation(KScalar))用标量实现
+ * findByte直接用memchr：glibc的memchr自己会按CPU选SSE2/AVX2/EVEX的实现，比这里的AVX2实现还快
+ * 查找范围都是[begin, end)，没找到返回nullptr
+*/
+class ByteScan
+{
+public:
+    enum Implementation { KScalar, KSSE2, KAVX2 };
+
+    // findAny向量化实现最多支持的分隔符个数，超过的用查表的标量实现
+    static const size_t KMaxVectorDelimiters = 8;
+
+    // 第一个c  memchr
+    static const char* findByte(const char *begin, const char *end, char c);
+    // 第一个属于delimiters[0, numDelimiters)的字节
+    static const char* findAny(const char *begin, const char *end, const char *delimiters, size_t numDelimiters);
+    // 第一个"\r\n"，返回'\r'的位置
+    static const char* findCRLF(const char *begin, const char *end);
+
+    static Implementation implementation();
+    static const char* implementationName();
+    // 切换实现(压测对比用)，CPU不支持返回false  不是线程安全的，要在其它线程开始查找之前调用
+    static bool setImplementation(Implementation impl);
+};
@@ -13,8 +13,10 @@ using ConnectionCallback = std::function<void(const TcpConnectionPtr&)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr&)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr&)>;
 
-using MessageCallback = std::function<void(const TcpConnectionPtr&
+using MessageCallback = std::function<void(const TcpConnectionPtr&,
                                             Buffer*,
                                             Timestamp)>;
 
-using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr, size_t)>   ;                                      
\ No newline at end of file
+using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr, size_t)>;
+
+using TimerCallback = std::function<void()>;
@@ -0,0 +1,267 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const size_t ChainBuffer::KBlockSize;
+const size_t ChainBuffer::KMaxCopySliceSize;
+
+// sendfile一次最多发送的字节数(内核的上限是0x7ffff000)
+static const size_t KMaxSendFileBytes = 0x7ffff000;
+
+ChainBuffer::ChainBuffer()
+    : readableBytes_(0)
+    , zeroCopyThreshold_(0)
+    , zeroCopyNextSeq_(0)
+    {}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll(); // 块还给pool
+}
+
+size_t ChainBuffer::tailWritable() const
+{
+    if(segments_.empty() || segments_.back().block == nullptr)
+    {
+        return 0;
+    }
+    const Segment &tail = segments_.back();
+    return tail.capacity - (tail.data - tail.block) - tail.len;
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readableBytes_ += len;
+
+    // 先填满末尾块的剩余空间
+    size_t writable = std::min(tailWritable(), len);
+    if(writable > 0)
+    {
+        Segment &tail = segments_.back();
+        ::memcpy(const_cast<char*>(tail.data) + tail.len, data, writable);
+        tail.len += writable;
+        data += writable;
+        len -= writable;
+    }
+
+    // 剩下的放进一个新块  大的数据直接分配一整块，writev的时候也只占一个iovec
+    if(len > 0)
+    {
+        Segment seg;
+        seg.fileFd = -1;
+        seg.block = BufferPool::allocate(std::max(KBlockSize, len), &seg.capacity);
+        seg.data = seg.block;
+        seg.len = len;
+        ::memcpy(seg.block, data, len);
+        segments_.push_back(std::move(seg));
+    }
+}
+
+void ChainBuffer::appendSlice(const char *data, size_t len, std::shared_ptr<const void> owner)
+{
+    if(len <= KMaxCopySliceSize)
+    {
+        append(data, len);
+        return;
+    }
+    Segment seg;
+    seg.data = data;
+    seg.len = len;
+    seg.capacity = 0;
+    seg.block = nullptr;
+    seg.owner = std::move(owner);
+    seg.fileFd = -1;
+    segments_.push_back(std::move(seg));
+    readableBytes_ += len;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len)
+{
+    if(len == 0)
+    {
+        ::close(fd);
+        return;
+    }
+    Segment seg;
+    seg.data = nullptr;
+    seg.len = len;
+    seg.capacity = 0;
+    seg.block = nullptr;
+    seg.fileFd = fd;
+    seg.fileOffset = offset;
+    segments_.push_back(std::move(seg));
+    readableBytes_ += len;
+}
+
+void ChainBuffer::releaseSegment(Segment &seg)
+{
+    if(seg.fileFd >= 0)
+    {
+        ::close(seg.fileFd);
+        seg.fileFd = -1;
+    }
+    BufferPool::deallocate(seg.block, seg.capacity);
+    seg.block = nullptr;
+}
+
+void ChainBuffer::append(ChainBuffer &other)
+{
+    for(Segment &seg : other.segments_)
+    {
+        segments_.push_back(std::move(seg));
+    }
+    readableBytes_ += other.readableBytes_;
+    other.segments_.clear();
+    other.readableBytes_ = 0;
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    len = std::min(len, readableBytes_);
+    readableBytes_ -= len;
+    while(len > 0)
+    {
+        Segment &head = segments_.front();
+        if(len < head.len)
+        {
+            // 只发出去了这个内存段的一部分
+            if(head.fileFd >= 0)
+            {
+                head.fileOffset += len;
+            }
+            else
+            {
+                head.data += len;
+            }
+            head.len -= len;
+            return;
+        }
+        len -= head.len;
+        releaseSegment(head);
+        segments_.pop_front();
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    retrieve(readableBytes_);
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* saveErrno)
+{
+    if(!segments_.empty() && segments_.front().fileFd >= 0)
+    {
+        return sendFileSegment(fd, saveErrno);
+    }
+    if(zeroCopyThreshold_ > 0 && !segments_.empty())
+    {
+        const Segment &head = segments_.front();
+        if(head.owner && head.len >= zeroCopyThreshold_)
+        {
+            return sendZeroCopySegment(fd, saveErrno);
+        }
+    }
+
+    // 把开头连续的内存段(最多IOV_MAX个)一次写到fd中，遇到文件区间停下，下一次再sendfile
+    struct iovec vec[IOV_MAX];
+    int iovcnt = 0;
+    for(const Segment &seg : segments_)
+    {
+        if(iovcnt == IOV_MAX || seg.fileFd >= 0)
+        {
+            break;
+        }
+        vec[iovcnt].iov_base = const_cast<char*>(seg.data);
+        vec[iovcnt].iov_len = seg.len;
+        ++iovcnt;
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if(n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::sendFileSegment(int fd, int* saveErrno)
+{
+    Segment &head = segments_.front();
+    off_t offset = head.fileOffset; // sendfile会修改offset，真正的偏移在retrieve里更新
+    ssize_t n = ::sendfile(fd, head.fileFd, &offset, std::min(head.len, KMaxSendFileBytes));
+    if(n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else if(n == 0)
+    {
+        // 文件比appendFile时给的长度短，剩下的部分永远发不出去  不能跳过这个区间接着发后面的数据，
+        // 否则对端收到的字节流中间少了一段却不知道，当成EIO报给上层，由TcpConnection断开连接
+        LOG_ERROR("ChainBuffer::writeFd file fd=%d truncated, %lu bytes left \n", head.fileFd, head.len);
+        *saveErrno = EIO;
+        n = -1;
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::sendZeroCopySegment(int fd, int* saveErrno)
+{
+    Segment &head = segments_.front();
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(head.data);
+    vec.iov_len = head.len;
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+
+    ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+    if(n > 0)
+    {
+        // 这段内存被内核引用着，retrieve之后也要等完成通知才能释放owner
+        zeroCopyPending_.emplace_back(zeroCopyNextSeq_++, head.owner);
+    }
+    else if(n < 0)
+    {
+        *saveErrno = errno;
+        if(errno == ENOBUFS) // 超过了optmem_max，这一次退回普通的拷贝发送
+        {
+            n = ::write(fd, head.data, head.len);
+            if(n < 0)
+            {
+                *saveErrno = errno;
+            }
+        }
+    }
+    return n;
+}
+
+void ChainBuffer::zeroCopyCompleted(uint32_t lo, uint32_t hi, bool copied)
+{
+    // TCP的完成通知是按顺序的，而且内核只会合并相邻的区间，lo应该正好接在上一次通知的后面
+    if(!zeroCopyPending_.empty() && static_cast<int32_t>(zeroCopyPending_.front().first - lo) < 0)
+    {
+        LOG_ERROR("ChainBuffer zerocopy completion [%u, %u] skips pending send %u \n",
+            lo, hi, zeroCopyPending_.front().first);
+    }
+    // [lo, hi]之前的发送都已经完成
+    while(!zeroCopyPending_.empty() && static_cast<int32_t>(zeroCopyPending_.front().first - hi) <= 0)
+    {
+        zeroCopyPending_.pop_front();
+    }
+    if(copied)
+    {
+        // 内核没能零拷贝(比如走的是loopback)，还白白多了一次错误队列的通知，以后不再用MSG_ZEROCOPY
+        LOG_DEBUG("ChainBuffer zerocopy [%u, %u] was copied by kernel, zerocopy disabled \n", lo, hi);
+        zeroCopyThreshold_ = 0;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Slice.h"
+
+#include <deque>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * 发送用的链式缓冲区  由一串内存段组成
+ * 1. 从BufferPool分配的定长块(KBlockSize)：append拷贝进来，写满一块再分配下一块，不会resize整个缓冲区，也不会把数据挪回开头
+ * 2. 外部持有的内存片：appendSlice不拷贝，owner保证数据发送完之前内存一直有效
+ * 3. 文件区间：appendFile，数据不进用户态，发送的时候用sendfile
+ * writeFd用writev一次把最多IOV_MAX个内存段写到fd上，header + body + trailer不需要先拼成一块
+ * 开头是文件区间的时候改用sendfile，和前后的内存段严格按照append的顺序发送
+ * 开启零拷贝以后，开头是不小于阈值的外部内存片时用sendmsg(MSG_ZEROCOPY)，内核直接引用这段内存，
+ * owner一直保留到从socket的错误队列读到完成通知(zeroCopyCompleted)为止
+*/
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t KBlockSize = 16 * 1024;
+    // 小于等于这个长度的外部内存片直接拷贝进块里，比多占一个iovec、多持有一次owner便宜
+    static const size_t KMaxCopySliceSize = 4 * 1024;
+
+    ChainBuffer();
+    ~ChainBuffer();
+
+    size_t readableBytes() const { return readableBytes_; }
+    // 内存段的个数
+    size_t numSegments() const { return segments_.size(); }
+
+    // 把[data, data+len]的数据拷贝到缓冲区的末尾
+    void append(const char *data, size_t len);
+    void append(const std::string &str) { append(str.data(), str.size()); }
+    // 把外部的内存片挂到缓冲区的末尾，不拷贝  owner在这段数据发送完(retrieve)之后才释放
+    // 不超过KMaxCopySliceSize的小内存片还是拷贝
+    void appendSlice(const char *data, size_t len, std::shared_ptr<const void> owner);
+    void appendSlice(const Slice &slice) { appendSlice(slice.data(), slice.size(), slice.owner()); }
+    // 把文件fd的[offset, offset+len)区间挂到缓冲区的末尾，ChainBuffer接管fd，发送完(retrieve)或者析构的时候close
+    void appendFile(int fd, off_t offset, size_t len);
+    // 把other中的所有内存段移动到末尾，other变为空  不拷贝数据
+    void append(ChainBuffer &other);
+
+    // 丢弃开头len字节的数据
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 通过fd发送数据  writev，开头是文件区间的时候用sendfile
+    ssize_t writeFd(int fd, int* saveErrno);
+
+    // 不小于threshold字节的外部内存片用MSG_ZEROCOPY发送，0表示关闭  fd上要先设置SO_ZEROCOPY
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // 内核通知[lo, hi]这几次MSG_ZEROCOPY发送已经完成，释放对应的owner  copied表示内核实际上还是拷贝了
+    void zeroCopyCompleted(uint32_t lo, uint32_t hi, bool copied);
+    // 已经发出去、还在等完成通知的MSG_ZEROCOPY发送次数
+    size_t pendingZeroCopy() const { return zeroCopyPending_.size(); }
+private:
+    struct Segment
+    {
+        const char *data; // 可读数据的起始地址
+        size_t len; // 可读数据的长度
+        size_t capacity; // 自己分配的块的大小，外部内存片为0
+        char *block; // 从BufferPool分配的块，外部内存片为nullptr
+        std::shared_ptr<const void> owner; // 外部内存片的持有者
+        int fileFd; // 文件区间的fd，内存段为-1
+        off_t fileOffset; // 文件区间还没发送的部分的起始偏移
+    };
+
+    // 开头的文件区间用sendfile发送
+    ssize_t sendFileSegment(int fd, int* saveErrno);
+    // 开头的外部内存片用sendmsg(MSG_ZEROCOPY)发送
+    ssize_t sendZeroCopySegment(int fd, int* saveErrno);
+    // 释放一个已经发送完(或者丢弃)的内存段
+    static void releaseSegment(Segment &seg);
+
+    // 末尾的块还能写多少字节  末尾不是自己分配的块返回0
+    size_t tailWritable() const;
+
+    std::deque<Segment> segments_;
+    size_t readableBytes_;
+
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopyNextSeq_; // 内核给这个socket上每次成功的MSG_ZEROCOPY发送编号，从0开始
+    std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> zeroCopyPending_; // <编号, 内存片的owner>
+};
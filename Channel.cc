@@ -1,6 +1,6 @@
 #include "Channel.h"
 #include "EventLoop.h"
-#include "logger.h"
+#include "Logger.h"
 
 #include <sys/epoll.h>
 #include <memory>
@@ -11,16 +11,17 @@ const int Channel::KReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::KWriteEvent = EPOLLOUT;
 
 // EventLoop: ChannelList Poller
-Channel::Channel(EvnetLoop* loop, int fd)
+Channel::Channel(EventLoop* loop, int fd)
     :loop_(loop)
     ,fd_(fd)
     ,events_(0)
     ,revents_(0)
     ,index_(-1)
+    ,edgeTriggered_(false)
     ,tied_(false)
     {}
 
-Channel::~Channel
+Channel::~Channel()
 {
     // 断言
 }
@@ -29,7 +30,7 @@ Channel::~Channel
 // 一个TcpConnection新连接创建的时候
 void Channel::tie(const std::shared_ptr<void>& obj)
 {
-    tid_ = obj; // 用weak_ptr，来观测绑定的shared_ptr的情况
+    tie_ = obj; // 用weak_ptr，来观测绑定的shared_ptr的情况
     tied_ = true;
 }
 
@@ -21,7 +21,7 @@ public:
     using EventCallback = std::function<void()>;
     using ReadEventCallback = std::function<void(Timestamp)>;
 
-    Channel(EvnetLoop* loop, int fd);
+    Channel(EventLoop* loop, int fd);
     ~Channel();
 
     // fd得到poller通知后，处理事件的。调用相应的回调
@@ -52,7 +52,7 @@ public:
     int events() const { return events_; }
     //给poller提供接口设置revents_
     void set_revents(int revt) { revents_ = revt; }
-    bool isNoneEvent() const { return events_ == KNoneEvent; }
+    int revents() const { return revents_; }
 
     //设置fd相应的事件状态
     void enableReading() { events_ |= KReadEvent; update(); }
@@ -66,6 +66,10 @@ public:
     bool isReadEvent() const { return events_ & KReadEvent; }
     bool isWriteEvent() const { return events_ & KWriteEvent; }
 
+    // 边缘触发(EPOLLET)  需要在enableReading/enableWriting之前设置
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
     int index() { return index_; }
     void set_index(int index) { index_ = index; }
 
@@ -86,6 +90,7 @@ private:
     int events_; // 注册fd感兴趣的事件
     int revents_; // poller返回的具体发生的事件
     int index_;
+    bool edgeTriggered_;
 
     std::weak_ptr<void> tie_;
     bool tied_;
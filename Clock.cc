@@ -0,0 +1,91 @@
+#include "Clock.h"
+#include "Logger.h"
+
+#if MUDUO_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+const int64_t TscClock::KCalibrationNs;
+
+int64_t Clock::coarseResolutionNs()
+{
+    struct timespec ts;
+    ::clock_getres(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// CPUID.80000007H:EDX[8]  不变TSC
+static bool hasInvariantTsc()
+{
+#if MUDUO_HAVE_TSC
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if(__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+    {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// 读一对(ticks, ns)  ns前后各读一次ticks取中点，减小两次读之间被打断带来的误差
+// 读几次取前后间隔最短的一次：库加载时第一次clock_gettime要解析符号、缺页，那一次的中点会偏好几微秒
+static void samplePair(uint64_t *ticks, int64_t *ns)
+{
+    uint64_t bestWindow = UINT64_MAX;
+    for(int i = 0;i < 8;i++)
+    {
+        uint64_t before = TscClock::ticks();
+        int64_t now = Clock::monotonicNs();
+        uint64_t after = TscClock::ticks();
+        if(after - before < bestWindow)
+        {
+            bestWindow = after - before;
+            *ticks = before + (after - before) / 2;
+            *ns = now;
+        }
+    }
+}
+
+TscClock::TscClock()
+    : available_(false)
+    , nsPerTick_(1.0)
+    , baseTicks_(0)
+    , baseNs_(0)
+{
+    if(!hasInvariantTsc())
+    {
+        LOG_INFO("TscClock: no invariant TSC, falling back to CLOCK_MONOTONIC \n");
+        return;
+    }
+
+    uint64_t ticks0, ticks1;
+    int64_t ns0, ns1;
+    samplePair(&ticks0, &ns0);
+    struct timespec ts = { 0, static_cast<long>(KCalibrationNs) };
+    ::nanosleep(&ts, nullptr);
+    samplePair(&ticks1, &ns1);
+
+    if(ticks1 <= ticks0 || ns1 <= ns0)
+    {
+        LOG_ERROR("TscClock: calibration failed, falling back to CLOCK_MONOTONIC \n");
+        return;
+    }
+    nsPerTick_ = static_cast<double>(ns1 - ns0) / static_cast<double>(ticks1 - ticks0);
+    baseTicks_ = ticks1;
+    baseNs_ = ns1;
+    available_ = true;
+}
+
+// 库加载的时候就校准TscClock
+class TscCalibrator
+{
+public:
+    TscCalibrator()
+    {
+        TscClock::available();
+    }
+};
+static TscCalibrator initObj;
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MUDUO_HAVE_TSC 1
+#else
+#define MUDUO_HAVE_TSC 0
+#endif
+
+/**
+ * 单调时钟  量时间差用，不受系统时间调整的影响，单位ns
+ * monotonicNs: CLOCK_MONOTONIC，走vDSO，不陷入内核
+ * coarseNs: CLOCK_MONOTONIC_COARSE，只读内核每个tick更新一次的时间，不读时钟硬件  精度是一个tick(coarseResolutionNs)
+ *           给超时检查、空闲判断这类毫秒级就够的地方用
+*/
+class Clock
+{
+public:
+    static int64_t monotonicNs()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static int64_t coarseNs()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static int64_t coarseResolutionNs();
+};
+
+/**
+ * 用rdtsc计时  亚微秒的延迟测量用，比clock_gettime少了vDSO里读时钟源、换算、处理seqlock重试的开销
+ * 库加载的时候用CLOCK_MONOTONIC校准一次频率(大约10ms)，之后只是一次rdtsc和一次乘法
+ * 不能等到第一次使用再校准：第一次使用是在EventLoop::loop()里，那个loop会卡住10ms
+ * CPU不支持不变TSC(invariant TSC: 频率恒定，深度睡眠也不停)的时候available()为false，nowNs退回到Clock::monotonicNs
+ * nowNs的起点是校准时的CLOCK_MONOTONIC，但是频率有ppm级的误差，只用来量时间差，不要和Clock::monotonicNs的时间点混着比较
+*/
+class TscClock : noncopyable
+{
+public:
+    static bool available() { return instance().available_; }
+
+    static uint64_t ticks()
+    {
+#if MUDUO_HAVE_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(Clock::monotonicNs());
+#endif
+    }
+
+    static int64_t nowNs()
+    {
+        const TscClock &clock = instance();
+        if(!clock.available_)
+        {
+            return Clock::monotonicNs();
+        }
+        // 按有符号数算差值：别的CPU上读到的TSC可能比校准时的baseTicks_还小一点，无符号相减会回绕成一个巨大的数
+        int64_t elapsed = static_cast<int64_t>(ticks() - clock.baseTicks_);
+        return clock.baseNs_ + static_cast<int64_t>(static_cast<double>(elapsed) * clock.nsPerTick_);
+    }
+
+    // 两次ticks()之差换算成ns
+    static double ticksToNs(uint64_t ticks) { return static_cast<double>(ticks) * instance().nsPerTick_; }
+    // 校准出来的TSC频率，不可用的时候是0
+    static double ticksPerSecond() { return instance().available_ ? 1e9 / instance().nsPerTick_ : 0; }
+
+private:
+    static const int64_t KCalibrationNs = 10 * 1000 * 1000;
+
+    TscClock();
+    static const TscClock& instance()
+    {
+        static TscClock clock; // C++11保证只初始化一次
+        return clock;
+    }
+
+    bool available_;
+    double nsPerTick_;
+    uint64_t baseTicks_;
+    int64_t baseNs_;
+};
@@ -0,0 +1,124 @@
+#include "Crc32c.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#define MUDUO_CRC32C_X86 1
+#include <nmmintrin.h>
+#endif
+
+static const uint32_t KPolynomial = 0x82f63b78; // Castagnoli多项式(按位反转)
+
+// slicing-by-8的表  table[k][b]: 字节b后面再跟k个0字节的CRC
+static uint32_t g_table[8][256];
+
+static bool initTable()
+{
+    for(uint32_t b = 0;b < 256;b++)
+    {
+        uint32_t crc = b;
+        for(int i = 0;i < 8;i++)
+        {
+            crc = (crc >> 1) ^ (KPolynomial & (0 - (crc & 1)));
+        }
+        g_table[0][b] = crc;
+    }
+    for(uint32_t b = 0;b < 256;b++)
+    {
+        for(int k = 1;k < 8;k++)
+        {
+            g_table[k][b] = (g_table[k - 1][b] >> 8) ^ g_table[0][g_table[k - 1][b] & 0xff];
+        }
+    }
+    return true;
+}
+
+static uint32_t extendSoftware(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while(len >= 8)
+    {
+        uint32_t low;
+        uint32_t high;
+        ::memcpy(&low, p, sizeof low);
+        ::memcpy(&high, p + 4, sizeof high);
+        low ^= crc; // 小端
+        crc = g_table[7][low & 0xff] ^ g_table[6][(low >> 8) & 0xff]
+            ^ g_table[5][(low >> 16) & 0xff] ^ g_table[4][low >> 24]
+            ^ g_table[3][high & 0xff] ^ g_table[2][(high >> 8) & 0xff]
+            ^ g_table[1][(high >> 16) & 0xff] ^ g_table[0][high >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while(len > 0)
+    {
+        crc = (crc >> 8) ^ g_table[0][(crc ^ *p) & 0xff];
+        ++p;
+        --len;
+    }
+    return crc;
+}
+
+#ifdef MUDUO_CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t extendHardware(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t crc64 = crc;
+    while(len >= 8)
+    {
+        uint64_t word;
+        ::memcpy(&word, p, sizeof word);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while(len > 0)
+    {
+        crc = _mm_crc32_u8(crc, *p);
+        ++p;
+        --len;
+    }
+    return crc;
+}
+#endif
+
+static bool cpuSupportsCrc32()
+{
+#ifdef MUDUO_CRC32C_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+static bool g_tableReady = initTable();
+static bool g_hardware = cpuSupportsCrc32();
+
+uint32_t Crc32c::extend(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#ifdef MUDUO_CRC32C_X86
+    if(g_hardware)
+    {
+        return ~extendHardware(crc, p, len);
+    }
+#endif
+    return ~extendSoftware(crc, p, len);
+}
+
+bool Crc32c::hardwareAccelerated()
+{
+    return g_hardware;
+}
+
+bool Crc32c::setHardwareAccelerated(bool on)
+{
+    if(on && !cpuSupportsCrc32())
+    {
+        return false;
+    }
+    g_hardware = on;
+    return true;
+}
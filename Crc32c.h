@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * CRC32C(Castagnoli)校验  LengthHeaderCodec的帧校验用
+ * x86上CPU支持SSE4.2的时候用crc32指令，一次8字节；否则用slicing-by-8查表
+*/
+class Crc32c
+{
+public:
+    // 接着前面数据的校验值crc继续计算data，可以分段计算
+    static uint32_t extend(uint32_t crc, const void *data, size_t len);
+    static uint32_t value(const void *data, size_t len) { return extend(0, data, len); }
+
+    static bool hardwareAccelerated();
+    // 切换硬件/查表实现(压测对比用)，CPU不支持返回false  要在其它线程开始计算之前调用
+    static bool setHardwareAccelerated(bool on);
+};
@@ -1,5 +1,7 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h>
 
@@ -9,8 +11,20 @@ Poller* Poller::newDefaultPoller(EventLoop *loop)
     {
         return nullptr; // 生成poll的实例
     }
+    else if(::getenv("MUDUO_USE_IO_URING"))
+    {
+        IoUringPoller *poller = new IoUringPoller(loop); // 生成io_uring的实例
+        if(poller->valid())
+        {
+            return poller;
+        }
+        // 内核不支持io_uring，退回到epoll
+        LOG_ERROR("io_uring is not available, fall back to epoll\n");
+        delete poller;
+        return new EPollPoller(loop);
+    }
     else
     {
         return new EPollPoller(loop); // 生成epoll的实例
     }
-}
\ No newline at end of file
+}
@@ -2,7 +2,7 @@
 #include "Logger.h"
 
 #include <errno.h>
-#include <Channel.h>
+#include "Channel.h"
 #include <unistd.h>
 #include <strings.h>
 
@@ -33,17 +33,17 @@ EPollPoller::~EPollPoller()
 // 调用epoll_wait, 针对不同情况，进行处理
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    // 实际上应该用LOG_DEBUG输出日志更为合理
-    LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    // 每一轮poll都会走到这里，只能是LOG_DEBUG
+    LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, numChannels_);
 
     // 第二个参数要给数组的起始地址
-    int numEvents = ::epoll_wait(epollfd, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
+    int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int savedErrno = errno;
     Timestamp now(Timestamp::now());
 
     if(numEvents > 0) //有发生事件fd：fd个数
     {
-        LOG_INFO("%d events happened.\n", numEvents);
+        LOG_DEBUG("%d events happened.\n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
 
         if(numEvents == events_.size()) //扩容
@@ -57,7 +57,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
     }
     else
     {
-        if(saveError != EINTR) //不是外部中断
+        if(savedErrno != EINTR) //不是外部中断
         {
             errno = savedErrno;
             LOG_ERROR("EPollPoller::poll() err!");
@@ -70,18 +70,23 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 // channel update remove => EventLoop updateChannel removeChannel => Poller
 /*       EventLoop
  *  ChannelList     Poller
- *                  ChannelMap  <fd, channel*>
+ *                  ChannelMap  channels_[fd] = channel*
 */
 void EPollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index();
-    LOG_INFO("func=%s => fd=%d, events=%d, index=%d \n",__FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_DEBUG("func=%s => fd=%d, events=%d, index=%d \n",__FUNCTION__, channel->fd(), channel->events(), index);
     if(index == KNew || index == KDeleted)
     {
         if(index == KNew)
         {
-            int fd = channel->fd();
-            channels_[fd] = channel;
+            addChannel(channel);
+        }
+        if(channel->isNoneEvent())
+        {
+            // 不在epoll中并且没有感兴趣的事件，不用ADD  否则EPOLLHUP/EPOLLERR还是会报上来
+            channel->set_index(KDeleted);
+            return;
         }
 
         channel->set_index(KAdded);
@@ -89,10 +94,10 @@ void EPollPoller::updateChannel(Channel *channel)
     }
     else // channel已经在poller上注册过了
     {
-        int fd = channel->fd();
         if(channel->isNoneEvent())
         {
             update(EPOLL_CTL_DEL, channel);
+            channel->set_index(KDeleted); // 还在channels_中，只是不在epoll中了
         }
         else
         {
@@ -107,9 +112,9 @@ void EPollPoller::removeChannel(Channel *channel)
     int fd = channel->fd();
     int index = channel->index();
 
-    LOG_INFO("func=%s => fd=%d\n",__FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd=%d\n",__FUNCTION__, fd);
 
-    channels_.erase(fd);
+    eraseChannel(fd);
 
     if(index == KAdded)
     {
@@ -143,9 +148,12 @@ void EPollPoller::update(int operation, Channel *channel)
     epoll_event event;
     bzero(&event, sizeof(event));
     event.events = channel->events();
+    if(channel->isEdgeTriggered())
+    {
+        event.events |= EPOLLET;
+    }
     event.data.ptr = channel;
     int fd = channel->fd();
-    event.data.fd = fd;
     if(::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if(operation == EPOLL_CTL_DEL)
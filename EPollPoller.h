@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Poller.h"
-#include "Timestamp"
+#include "Timestamp.h"
 
 #include <vector>
 #include <sys/epoll.h>
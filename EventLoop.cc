@@ -2,11 +2,14 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "BufferPool.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <errno>
+#include <signal.h>
+#include <errno.h>
 
 // 防止一个线程创建多个EventLoop
 __thread EventLoop *t_loopInThisThread = nullptr;
@@ -14,6 +17,18 @@ __thread EventLoop *t_loopInThisThread = nullptr;
 // 定义默认的Poller I/O复用接口的超时时间
 const int kPollTimeMs = 10000;
 
+// 对端已经关闭的socket/读端已经关闭的pipe，write/splice会产生SIGPIPE，默认处理是结束进程
+// 这里统一忽略，错误通过EPIPE返回
+class IgnoreSigPipe
+{
+public:
+    IgnoreSigPipe()
+    {
+        ::signal(SIGPIPE, SIG_IGN);
+    }
+};
+static IgnoreSigPipe initObj;
+
 // 创建wakeupfd, 用来notify subReactor处理新来的channel
 int createEventfd()
 {
@@ -28,11 +43,22 @@ int createEventfd()
 EventLoop::EventLoop()
   : looping_(false)
   , quit_(false)
-  , callingPendingFunctors_(false)
   , threadId_(CurrentThread::tid())
   , poller_(Poller::newDefaultPoller(this))
+  , timerQueue_(new TimerQueue(this))
   , wakeupFd_(createEventfd())
   , wakeupChannel_(new Channel(this, wakeupFd_))
+  , callingPendingFunctors_(false)
+  , wakeupPending_(false)
+  , busyPollUs_(0)
+  , spinning_(false)
+  , lastBusyNs_(0)
+  , numConnections_(0)
+  , numPendingFunctors_(0)
+  , numActiveChannels_(0)
+  , readBudget_(0)
+  , bufferPool_(new BufferPool())
+  , metrics_(new LoopMetrics())
   {
     LOG_DEBUG("EventLoop created %p in thread %d", this, threadId_);
     if(t_loopInThisThread)
@@ -42,6 +68,7 @@ EventLoop::EventLoop()
     else
     {
         t_loopInThisThread = this;
+        BufferPool::setThreadPool(bufferPool_.get());
     }
 
     //设置wakeupfd的事件类型以及发生事件后的回调操作
@@ -56,6 +83,7 @@ EventLoop::~EventLoop()
     wakeupChannel_->remove();
     ::close(wakeupFd_);
     t_loopInThisThread = nullptr;
+    BufferPool::setThreadPool(nullptr); // 之后在这个线程释放的块直接free
 }
 
 void EventLoop::handleRead()
@@ -69,13 +97,14 @@ void EventLoop::handleRead()
 }
 
 //开启事件循环
-void loop()
+void EventLoop::loop()
 {
     looping_ = true;
     quit_ = false;
 
     LOG_INFO("EventLoop %p start looping", this);
 
+    int64_t pollStart = LoopMetrics::nowNs();
     while(!quit_)
     {
         activeChannels_.clear();
@@ -86,12 +115,21 @@ void loop()
        /**
         * 监听两类fd  一种是client的fd，一种是wakefd
        */
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        int timeoutMs = kPollTimeMs;
+        if(busyPollUs_.load(std::memory_order_relaxed) > 0 || spinning_.load(std::memory_order_relaxed))
+        {
+            timeoutMs = busyPollTimeout(pollStart);
+        }
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        int64_t pollEnd = LoopMetrics::nowNs();
+        metrics_->recordPoll(pollEnd - pollStart, activeChannels_.size());
+        numActiveChannels_.store(static_cast<int>(activeChannels_.size()), std::memory_order_relaxed);
         for(Channel* channel : activeChannels_)
         {
             // poller监听哪些channel发生事件了，然后上报给EventLoop，通知channel处理相应的事件
             channel->handleEvent(pollReturnTime_);
         }
+        numActiveChannels_.store(0, std::memory_order_relaxed);
 
         // 执行当前EventLoop事件循环需要处理的回调操作
         /**
@@ -99,13 +137,41 @@ void loop()
          * mainLoop事先注册一个回调cb(需要subloop来执行) 
          * 唤醒subloop后，执行下面的方法，执行之前mainLoop注册的回调
         */
-        doPendingFunctors();
+        size_t numFunctors = doPendingFunctors();
+        // 这一轮的结束就是下一轮poll的开始，每一轮只多读两次时钟
+        pollStart = LoopMetrics::nowNs();
+        metrics_->recordIteration(pollStart - pollEnd);
+        if(!activeChannels_.empty() || numFunctors > 0)
+        {
+            lastBusyNs_ = pollStart;
+        }
     }
 
-    LOG_INFO("EventLoop %p stop looping.", this)
+    LOG_INFO("EventLoop %p stop looping.", this);
     looping_ = false;
 }
 
+int EventLoop::busyPollTimeout(int64_t nowNs)
+{
+    // 自旋的时候每一轮poll的超时都是0，nowNs(上一轮结束时读的时钟)一直是新的
+    int64_t idleNs = nowNs - lastBusyNs_;
+    if(idleNs < static_cast<int64_t>(busyPollUs_.load(std::memory_order_relaxed)) * 1000)
+    {
+        spinning_.store(true);
+        return 0; // 继续自旋
+    }
+
+    // 自旋时间用完了，准备阻塞在poll上
+    // 先清掉spinning_再检查队列：自旋期间push了回调又没有写eventfd的线程，这里一定能看到它的回调
+    spinning_.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!pendingFunctors_.empty())
+    {
+        return 0;
+    }
+    return kPollTimeMs;
+}
+
 //退出事件循环
 /**
  * 1. loop在自己的线程中调用quit
@@ -142,7 +208,7 @@ void EventLoop::runInLoop(Functor cb)
     } 
     else //在非当前loop线程中执行cb，就需要唤醒loop所在线程，执行cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
@@ -150,16 +216,27 @@ void EventLoop::runInLoop(Functor cb)
 //把cb放入队列中，唤醒loop所在线程，执行cb
 void EventLoop::queueInLoop(Functor cb)
 {
+    pendingFunctors_.push(std::move(cb));
+    numPendingFunctors_.fetch_add(1, std::memory_order_relaxed);
+
+    // loop正在忙轮询，每一轮都会检查pendingFunctors_，不需要写eventfd
+    // 和busyPollTimeout中的fence配对：要么loop看到了这个回调，要么这里看到spinning_ == false
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(spinning_.load(std::memory_order_relaxed))
     {
-        std::unique_lock<std::mutex> lock(mtx_);
-        pendingFunctors_.emplace_back(cb);
+        return;
     }
 
     // 唤醒相应的，需要执行上面回调操作的loop的线程了
     // callingPendingFunctors_ == true, 表示正在执行回调，但是loop又有了新的回调。当执行完回调后，又会poll阻塞，我们是需要去唤醒它的
     if(!isInLoopThread() || callingPendingFunctors_)
     {
-        wakeup(); // 唤醒loop所在线程
+        // loop在doPendingFunctors开始的时候才清掉wakeupPending_，在那之前push的回调都会被这一批执行
+        // 所以只有第一个把wakeupPending_从false改成true的线程需要写eventfd
+        if(!wakeupPending_.exchange(true))
+        {
+            wakeup(); // 唤醒loop所在线程
+        }
     }
 }
 
@@ -175,6 +252,28 @@ void EventLoop::wakeup() // main 唤醒 sub
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
 // 调用poller方法
 void EventLoop::updateChannel(Channel* channel)
 {
@@ -186,28 +285,34 @@ void EventLoop::removeChannel(Channel* channel)
 }
 bool EventLoop::hasChannel(Channel* channel)
 {
-    poller_->hasChannel(channel);
+    return poller_->hasChannel(channel);
 }
 
 // 执行回调
-void EventLoop::doPendingFunctors()
+size_t EventLoop::doPendingFunctors()
 {
     /**
-     * 局部变量functors, 进行swap
-     * 避免了频繁的加锁释放锁
+     * pendingFunctors_是无锁的MPSC队列，不需要加锁
+     * consume只执行开始时已经在队列中的回调，执行过程中新加入的留到下一轮(queueInLoop会唤醒)
      * 【mainLoop也需要往pendingFunctors_中放回调】
     */
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    // 先清标志再取回调：在这之后push回调的线程会重新写eventfd
+    wakeupPending_.exchange(false);
 
-    {
-        std::unqiue_lock<std::mutex> lock(mtx_);
-        functors.swap(pendingFunctors_);
-    }
-
-    for(const Functor& functor : functors)
-    {
+    int depth = numPendingFunctors_.load(std::memory_order_relaxed);
+    size_t count = pendingFunctors_.consume([](Functor &functor) {
         functor(); // 执行当前loop要执行的回调操作
-    }
+    });
+    numPendingFunctors_.fetch_sub(static_cast<int>(count), std::memory_order_relaxed);
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+    metrics_->recordFunctors(depth > 0 ? depth : 0, count);
+    return count;
+}
+
+void EventLoop::metricsSnapshot(LoopMetrics::Snapshot *snap) const
+{
+    metrics_->snapshot(snap);
+    snap->connections = numConnections();
+    snap->pendingFunctors = numPendingFunctors_.load(std::memory_order_relaxed);
+}
@@ -1,18 +1,23 @@
 #pragma once
 
 #include "noncopyable.h"
-#include "Timestamp"
+#include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "LoopMetrics.h"
 
 #include <functional>
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 
 
 class Channel;
 class Poller;
+class TimerQueue;
+class BufferPool;
 
 /**
  * mainLoop和subLoop中并没有消息队列的结构，mainLoop向消息队列放event，subLoop从消息队列拿event
@@ -33,7 +38,13 @@ public:
     //退出事件循环
     void quit();
 
-    Timestamp pollReturnTime const { return pollReturnTime_; }
+    Timestamp pollReturnTime() const { return pollReturnTime_; }
+    /**
+     * loop线程缓存的当前时间  每一轮poll返回的时候更新一次(就是pollReturnTime)
+     * 在loop线程的回调里代替Timestamp::now()，不用再读一次时钟；误差是这一轮已经处理了多久(见LoopMetrics的loopLag)
+     * 只能在loop线程里调用
+    */
+    Timestamp loopTime() const { return pollReturnTime_; }
 
     //在当前loop中执行cb
     void runInLoop(Functor cb);
@@ -43,6 +54,49 @@ public:
     //唤醒loop所在的线程的
     void wakeup(); // main 唤醒 sub
 
+    /**
+     * 忙轮询模式  给延迟敏感的loop用，可以跨线程调用
+     * 最近一次有事件/回调之后的spinUs微秒内，用0超时poll，并且不阻塞地检查pendingFunctors_，
+     * 其它线程queueInLoop的时候也不再写eventfd；空闲超过spinUs以后退回到阻塞的poll
+     * spinUs = 0 关闭忙轮询
+    */
+    void setBusyPoll(int spinUs) { busyPollUs_ = spinUs; }
+    int busyPollUs() const { return busyPollUs_; }
+
+    /**
+     * 负载计数  给EventLoopThreadPool的负载均衡策略用，都是relaxed的原子变量，任何线程都可以无锁读取
+     * numConnections: 分配给这个loop、还没有销毁的连接数
+     * pendingWork: 排队中的回调 + 这一轮poll返回、还在处理的channel数，反映loop当前的积压
+    */
+    void connectionAdded() { numConnections_.fetch_add(1, std::memory_order_relaxed); }
+    void connectionRemoved() { numConnections_.fetch_sub(1, std::memory_order_relaxed); }
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+    int pendingWork() const
+    {
+        return numPendingFunctors_.load(std::memory_order_relaxed) + numActiveChannels_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * 读预算  每个连接每次可读事件最多读多少字节，0表示不限制(ET模式的连接仍然最多读TcpConnection::KDefaultEdgeReadBudget)  可以跨线程调用
+     * 超出预算的数据留在socket里，LT模式下一轮poll还会通知，ET模式下放到这一轮的最后接着读
+     * 防止一个大流量的连接占满loop，饿死同一个loop上的其它连接
+    */
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    size_t readBudget() const { return readBudget_.load(std::memory_order_relaxed); }
+
+    // 运行指标(见LoopMetrics)  任何线程都可以调用，不会打断loop
+    void metricsSnapshot(LoopMetrics::Snapshot *snap) const;
+
+    // 定时器  回调都在loop所在的线程执行，可以跨线程调用
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒之后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
     // 调用poller方法
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
@@ -52,7 +106,10 @@ public:
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); } 
 private:
     void handleRead();
-    void doPendingFunctors();
+    // 返回执行的回调个数
+    size_t doPendingFunctors();
+    // 计算这一轮poll的超时时间，决定继续自旋还是阻塞  nowNs是上一轮结束时LoopMetrics::nowNs()读到的时间
+    int busyPollTimeout(int64_t nowNs);
 
     using ChannelList = std::vector<Channel*>;
     
@@ -63,6 +120,7 @@ private:
 
     Timestamp pollReturnTime_; // poller返回发生事件的channels的时间点
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_; // 定时器都通过timerfd注册在poller_上
 
     int wakeupFd_; // 当mainLoop获取一个新用户的channel，通过轮询算法选择一个subLoop,通过该成员唤醒subloop处理channel
     std::unique_ptr<Channel> wakeupChannel_;
@@ -70,6 +128,19 @@ private:
     ChannelList activeChannels_;
 
     std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
-    std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所有回调操作
-    std::mutex mtx_; //互斥锁，用来保护上面vector的线程安全操作
+    MpscQueue<Functor> pendingFunctors_; // 存储loop需要执行的所有回调操作  无锁队列，其它线程push，loop线程consume
+    std::atomic_bool wakeupPending_; // 已经有线程写过wakeupFd_，loop还没开始执行这一批回调，后来的线程不用再写了
+
+    std::atomic_int busyPollUs_; // 忙轮询的自旋时间(微秒)，0表示不自旋
+    std::atomic_bool spinning_; // loop正在忙轮询，queueInLoop不需要唤醒
+    int64_t lastBusyNs_; // 最近一次有事件或者回调的时间  LoopMetrics::nowNs()(单调时钟)，系统时间被往回调的时候不会变成一直自旋
+
+    std::atomic_int numConnections_; // 属于这个loop的连接数
+    std::atomic_int numPendingFunctors_; // pendingFunctors_中还没执行的回调数
+    std::atomic_int numActiveChannels_; // 这一轮poll返回、还没处理完的channel数
+
+    std::atomic<size_t> readBudget_; // 每个连接每次可读事件最多读的字节数
+
+    std::unique_ptr<BufferPool> bufferPool_; // 这个loop上的连接的Buffer都从这里分配内存块
+    std::unique_ptr<LoopMetrics> metrics_;
 };
\ No newline at end of file
@@ -30,9 +30,9 @@ EventLoop* EventLoopThread::startLoop()
     EventLoop *loop = nullptr;
     {
         std::unique_lock<std::mutex> lock(mutex_);
-        while(loop == nullptr)
+        while(loop_ == nullptr)
         {
-            cond_.wait();
+            cond_.wait(lock);
         }
         loop = loop_;
     }
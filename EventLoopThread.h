@@ -16,9 +16,12 @@ public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
-        const std::string &name = string());
+        const std::string &name = std::string());
     ~EventLoopThread();
 
+    // loop线程绑定的CPU  需要在startLoop之前调用
+    void setCpuAffinity(const std::vector<int> &cpus) { thread_.setCpuAffinity(cpus); }
+
     EventLoop* startLoop();
 private:
     void threadFunc();
@@ -1,5 +1,98 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 一致性哈希环上每个loop的虚拟节点数，越多分布越均匀
+static const int KVirtualNodes = 64;
+
+// hashCode可能是ip地址这种分布很差的值，先打散再上环(murmur3的fmix64)
+static size_t mixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+// 解析/sys下的cpulist格式，例如 "0-3,8-11"
+static std::vector<int> parseCpuList(const char *str)
+{
+    std::vector<int> cpus;
+    while(*str != '\0' && *str != '\n')
+    {
+        char *end = nullptr;
+        int first = static_cast<int>(::strtol(str, &end, 10));
+        int last = first;
+        if(end == str)
+        {
+            break;
+        }
+        if(*end == '-')
+        {
+            str = end + 1;
+            last = static_cast<int>(::strtol(str, &end, 10));
+        }
+        for(int cpu = first;cpu <= last;cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+        str = (*end == ',') ? end + 1 : end;
+    }
+    return cpus;
+}
+
+// 按照NUMA节点交错排列所有CPU：node0[0], node1[0], ..., node0[1], node1[1], ...
+// 读不到拓扑(没有NUMA或者容器里没挂/sys)的时候返回空，不绑核
+static std::vector<int> numaInterleavedCpus()
+{
+    std::vector<std::vector<int>> nodes;
+    for(int node = 0;;node++)
+    {
+        char path[64] = {0};
+        snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *fp = ::fopen(path, "r");
+        if(fp == nullptr)
+        {
+            break;
+        }
+        char line[1024] = {0};
+        if(::fgets(line, sizeof line, fp) != nullptr)
+        {
+            std::vector<int> cpus = parseCpuList(line);
+            if(!cpus.empty())
+            {
+                nodes.push_back(cpus);
+            }
+        }
+        ::fclose(fp);
+    }
+
+    std::vector<int> result;
+    for(size_t i = 0;;i++)
+    {
+        size_t added = 0;
+        for(const std::vector<int> &cpus : nodes)
+        {
+            if(i < cpus.size())
+            {
+                result.push_back(cpus[i]);
+                ++added;
+            }
+        }
+        if(added == 0)
+        {
+            break;
+        }
+    }
+    return result;
+}
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop)
@@ -7,6 +100,11 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
     , started_(false)
     , numThreads_(0)
     , next_(0)
+    , busyPollLoops_(0)
+    , busyPollUs_(0)
+    , strategy_(KRoundRobin)
+    , randomState_(2463534242u)
+    , numaSpread_(false)
     {}
 
 EventLoopThreadPool::~EventLoopThreadPool()
@@ -18,13 +116,41 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     started_ = true;
 
+    if(numaSpread_)
+    {
+        cpus_ = numaInterleavedCpus();
+        if(cpus_.empty())
+        {
+            LOG_ERROR("EventLoopThreadPool %s can not read NUMA topology, loops are not pinned \n", name_.c_str());
+        }
+    }
+
     for(int i = 0;i < numThreads_;i++)
     {
         char buf[name_.size() + 32];
-        snprintf(buf, sizeof buf, "%s%d", name.c_str(), i);
+        snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
-        threads_.push_back(std::unique_ptr<EventLoopThread(t)>);
+        if(!cpus_.empty())
+        {
+            t->setCpuAffinity(std::vector<int>(1, cpus_[i % cpus_.size()]));
+        }
+        threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop()); // 底层创建线程，绑定一个新的EventLoop,并返回该loop的地址
+        if(i < busyPollLoops_)
+        {
+            loops_.back()->setBusyPoll(busyPollUs_);
+        }
+    }
+
+    if(strategy_ == KConsistentHash)
+    {
+        for(size_t i = 0;i < loops_.size();i++)
+        {
+            for(int v = 0;v < KVirtualNodes;v++)
+            {
+                hashRing_[mixHash((static_cast<uint64_t>(i) << 32) | v)] = loops_[i];
+            }
+        }
     }
 
     // 整个服务端只有一个线程，运行着baseLoop
@@ -35,18 +161,102 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 }
 
 // 如果工作在多线程中，baseLoop_默认以轮询的方式分配channel给subloop
-EventLoop* EventLoopThreadPool::getNextLoop()
+EventLoop* EventLoopThreadPool::getNextLoop(size_t hashCode)
 {
     EventLoop* loop = baseLoop_;
-    if(!loops_.empty())
+    if(loops_.empty())
+    {
+        return loop;
+    }
+
+    switch(strategy_)
     {
-        loop = loops_[next_];
-        ++next_;
-        if(next_ >= loops_.size()) next_ = 0; 
+    case KLeastConnections:
+        return getLeastConnectionsLoop();
+    case KLeastPendingWork:
+        return getLeastPendingWorkLoop();
+    case KPowerOfTwoChoices:
+        return getPowerOfTwoChoicesLoop();
+    case KConsistentHash:
+        return getConsistentHashLoop(hashCode);
+    default:
+        break;
     }
+
+    loop = loops_[next_];
+    ++next_;
+    if(next_ >= loops_.size()) next_ = 0; 
     return loop;
 }
 
+/**
+ * 下面几个策略读的都是EventLoop的relaxed原子计数，只是某一时刻的近似值，不需要加锁
+ * 负载相同的时候从next_开始找，避免总是选中第一个loop
+*/
+EventLoop* EventLoopThreadPool::getLeastConnectionsLoop()
+{
+    size_t n = loops_.size();
+    size_t best = next_;
+    for(size_t i = 1;i < n;i++)
+    {
+        size_t idx = (next_ + i) % n;
+        if(loops_[idx]->numConnections() < loops_[best]->numConnections())
+        {
+            best = idx;
+        }
+    }
+    next_ = (best + 1) % n;
+    return loops_[best];
+}
+
+EventLoop* EventLoopThreadPool::getLeastPendingWorkLoop()
+{
+    size_t n = loops_.size();
+    size_t best = next_;
+    int bestWork = loops_[best]->pendingWork();
+    for(size_t i = 1;i < n;i++)
+    {
+        size_t idx = (next_ + i) % n;
+        int work = loops_[idx]->pendingWork();
+        if(work < bestWork)
+        {
+            best = idx;
+            bestWork = work;
+        }
+    }
+    next_ = (best + 1) % n;
+    return loops_[best];
+}
+
+EventLoop* EventLoopThreadPool::getPowerOfTwoChoicesLoop()
+{
+    // xorshift32
+    uint32_t x = randomState_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState_ = x;
+
+    size_t n = loops_.size();
+    EventLoop *a = loops_[x % n];
+    EventLoop *b = loops_[(x >> 16) % n];
+    // 连接数为主，积压的工作作为补充
+    int loadA = a->numConnections() + a->pendingWork();
+    int loadB = b->numConnections() + b->pendingWork();
+    return loadB < loadA ? b : a;
+}
+
+EventLoop* EventLoopThreadPool::getConsistentHashLoop(size_t hashCode)
+{
+    // 顺时针找第一个虚拟节点，超过末尾就绕回开头
+    auto it = hashRing_.lower_bound(mixHash(hashCode));
+    if(it == hashRing_.end())
+    {
+        it = hashRing_.begin();
+    }
+    return it->second;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
     if(loops_.empty()) // 没有创建过loop
@@ -54,4 +264,15 @@ std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
         return std::vector<EventLoop*>(1, baseLoop_);
     }
     return loops_;
-}
\ No newline at end of file
+}
+
+std::vector<LoopMetrics::Snapshot> EventLoopThreadPool::metricsSnapshot()
+{
+    std::vector<EventLoop*> loops = getAllLoops();
+    std::vector<LoopMetrics::Snapshot> snapshots(loops.size());
+    for(size_t i = 0;i < loops.size();i++)
+    {
+        loops[i]->metricsSnapshot(&snapshots[i]);
+    }
+    return snapshots;
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "LoopMetrics.h"
 
 #include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <map>
 
 
 class EventLoop;
@@ -16,27 +18,68 @@ class EventLoopThreadPool : noncopyable
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // getNextLoop选择subloop的策略
+    enum LoadBalance
+    {
+        KRoundRobin,        // 轮询
+        KLeastConnections,  // 连接数最少的loop
+        KLeastPendingWork,  // 积压(排队的回调+正在处理的事件)最少的loop
+        KPowerOfTwoChoices, // 随机挑两个loop，选负载小的那个
+        KConsistentHash,    // 按照hashCode(对端地址)在一致性哈希环上选loop，同一个对端总是落到同一个loop
+    };
+
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    // 前numLoops个subloop工作在忙轮询模式，自旋spinUs微秒后退回阻塞  需要在start之前调用
+    void setBusyPoll(int numLoops, int spinUs) { busyPollLoops_ = numLoops; busyPollUs_ = spinUs; }
+
+    // 需要在start之前调用
+    void setLoadBalance(LoadBalance strategy) { strategy_ = strategy; }
+
+    /**
+     * 绑核  需要在start之前调用
+     * setCpuAffinity: 第i个subloop绑定到cpus[i % cpus.size()]上
+     * setNumaSpread: 从/sys读取NUMA拓扑，subloop轮流分到各个节点上(node0的第一个CPU, node1的第一个CPU, node0的第二个CPU...)
+     * loop线程绑核之后才创建EventLoop/Poller，连接的Buffer也在loop线程里分配，内存按first-touch都落在本地节点
+    */
+    void setCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+    void setNumaSpread(bool on) { numaSpread_ = on; }
 
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     // 如果工作在多线程中，baseLoop_默认以轮询的方式分配channel给subloop
-    EventLoop* getNextLoop();
+    // hashCode只有KConsistentHash策略会用到  只在baseLoop线程调用
+    EventLoop* getNextLoop(size_t hashCode = 0);
 
     std::vector<EventLoop*> getAllLoops();
 
+    // 每个subloop(没有subloop的时候是baseLoop)的运行指标，顺序和getAllLoops一样  start之后任何线程都可以调用
+    std::vector<LoopMetrics::Snapshot> metricsSnapshot();
+
     bool started() const { return started_; }
-    const string& name() const { return name_; }
+    const std::string& name() const { return name_; }
 private:
+    EventLoop* getLeastConnectionsLoop();
+    EventLoop* getLeastPendingWorkLoop();
+    EventLoop* getPowerOfTwoChoicesLoop();
+    EventLoop* getConsistentHashLoop(size_t hashCode);
 
     EventLoop *baseLoop_; // 用户在编写服务端代码的时候，创建的loop
-    std::string name;
+    std::string name_;
     bool started_;
     int numThreads_;
-    int next_;
+    size_t next_;
+    int busyPollLoops_;
+    int busyPollUs_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
+
+    LoadBalance strategy_;
+    uint32_t randomState_; // KPowerOfTwoChoices用的xorshift随机数状态
+    std::map<size_t, EventLoop*> hashRing_; // KConsistentHash的哈希环，每个loop有KVirtualNodes个虚拟节点
+
+    std::vector<int> cpus_; // subloop依次绑定的CPU，空表示不绑核
+    bool numaSpread_;
 };
\ No newline at end of file
@@ -23,12 +23,12 @@ std::string InetAddress::toIpPort() const
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
     size_t end  = strlen(buf);
     uint16_t port = ntohs(addr_.sin_port);
-    sprintf(buf+end, ":%u", port, port);
+    sprintf(buf+end, ":%u", port);
     return buf;
 }
 uint16_t InetAddress::toPort() const
 {
-    return ntos(addr_.sin_port);
+    return ntohs(addr_.sin_port);
 }
 
 // #include <iostream>
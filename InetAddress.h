@@ -9,7 +9,7 @@ class InetAddress
 {
 public:
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");
-    explicit InetAddress(const scokaddr_in &addr)
+    explicit InetAddress(const sockaddr_in &addr)
         : addr_(addr)
         {}
 
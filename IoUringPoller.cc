@@ -0,0 +1,376 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <algorithm>
+
+// channel的成员index_ = -1
+const int KNew = -1; // channel没有添加到过poller中
+const int KAdded = 1; // channel已经添加到poller中
+
+// POLL_REMOVE等内部请求的user_data，完成事件直接丢弃
+const uint64_t KInternalTag = 0;
+
+// user_data = fd << 32 | generation
+static uint64_t makeUserData(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(fd) << 32) | generation;
+}
+
+static int io_uring_setup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ringfd, unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit, minComplete, flags, arg, argsz));
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , ringfd_(-1)
+    , nextGeneration_(0)
+    , pollRound_(0)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , sqes_(static_cast<io_uring_sqe*>(MAP_FAILED))
+    , sqeTail_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+{
+    if(!setupRing())
+    {
+        LOG_ERROR("io_uring setup error:%d\n", errno);
+        unmapRing();
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    unmapRing();
+}
+
+bool IoUringPoller::setupRing()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof params);
+    // 一个loop上可能有上万个连接同时就绪，把cq开大一点，避免cq溢出
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = KRingEntries * 8;
+
+    ringfd_ = io_uring_setup(KRingEntries, &params);
+    if(ringfd_ < 0)
+    {
+        return false;
+    }
+    // 需要通过IORING_ENTER_EXT_ARG给io_uring_enter传超时时间(linux 5.11+)
+    if(!(params.features & IORING_FEAT_EXT_ARG))
+    {
+        errno = ENOSYS;
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringfd_, IORING_OFF_SQ_RING);
+    if(sqRing_ == MAP_FAILED)
+    {
+        return false;
+    }
+    if(singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringfd_, IORING_OFF_CQ_RING);
+        if(cqRing_ == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                              ringfd_, IORING_OFF_SQES));
+    if(sqes_ == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqeTail_ = *sqTail_;
+    // sq的下标和sqes一一对应，只需要初始化一次
+    for(unsigned i = 0;i < sqEntries_;i++)
+    {
+        sqArray_[i] = i;
+    }
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+void IoUringPoller::unmapRing()
+{
+    if(sqes_ != MAP_FAILED)
+    {
+        ::munmap(sqes_, sqEntries_ * sizeof(io_uring_sqe));
+        sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if(cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if(sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+    }
+    if(ringfd_ >= 0)
+    {
+        ::close(ringfd_);
+        ringfd_ = -1;
+    }
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, numChannels_);
+
+    // 上一轮处理完事件的channel，以及新注册/修改过的channel，在这里统一提交poll请求
+    armPendingChannels();
+    submitAndWait(timeoutMs);
+    Timestamp now(Timestamp::now());
+
+    size_t numBefore = activeChannels->size();
+    fillActiveChannels(activeChannels);
+    if(activeChannels->size() > numBefore)
+    {
+        LOG_DEBUG("%lu events happened.\n", activeChannels->size() - numBefore);
+    }
+    else
+    {
+        LOG_DEBUG("%s timeout!\n", __FUNCTION__);
+    }
+    return now;
+}
+
+// channel update remove => EventLoop updateChannel removeChannel => Poller
+// 这里不直接发起系统调用，只是修改poll的状态，等下一轮poll的时候一起提交
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    LOG_DEBUG("func=%s => fd=%d, events=%d, index=%d \n",__FUNCTION__, fd, channel->events(), channel->index());
+    if(channel->index() == KNew)
+    {
+        addChannel(channel);
+        if(static_cast<size_t>(fd) >= slots_.size())
+        {
+            slots_.resize(channels_.size());
+        }
+        Slot slot = {0, 0, false, 0};
+        slots_[fd] = slot;
+        channel->set_index(KAdded);
+    }
+
+    Slot &slot = slots_[fd];
+    const uint32_t events = static_cast<uint32_t>(channel->events());
+    if(slot.armedEvents != 0 && slot.armedEvents != events)
+    {
+        // 感兴趣的事件变了，取消内核中旧的poll，按新的事件重新提交
+        cancelPoll(fd, slot);
+    }
+    if(slot.armedEvents == 0 && events != 0)
+    {
+        scheduleArm(fd, slot);
+    }
+}
+
+//从poller中删除channel
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    LOG_DEBUG("func=%s => fd=%d\n",__FUNCTION__, fd);
+
+    if(findChannel(fd) == channel)
+    {
+        Slot &slot = slots_[fd];
+        if(slot.armedEvents != 0)
+        {
+            cancelPoll(fd, slot);
+        }
+        slot.pendingArm = false;
+        eraseChannel(fd);
+    }
+    channel->set_index(KNew);
+}
+
+io_uring_sqe* IoUringPoller::getSqe()
+{
+    if(sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+    {
+        // sq满了，先把已经填好的请求提交掉，不等待完成事件
+        __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+        if(io_uring_enter(ringfd_, sqEntries_, 0, 0, nullptr, 0) < 0)
+        {
+            LOG_ERROR("io_uring_enter submit error:%d\n", errno);
+        }
+    }
+    io_uring_sqe *sqe = &sqes_[sqeTail_ & sqMask_];
+    ++sqeTail_;
+    memset(sqe, 0, sizeof *sqe);
+    return sqe;
+}
+
+void IoUringPoller::submitAndWait(int timeoutMs)
+{
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    bool hasCompletions = *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    if(toSubmit == 0 && hasCompletions)
+    {
+        return; // cq里面已经有事件了，不需要陷入内核
+    }
+
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof arg);
+    arg.ts = timeoutMs < 0 ? 0 : reinterpret_cast<uint64_t>(&ts);
+
+    // 一次系统调用：提交所有的poll请求，并等待至少一个完成事件
+    int ret = io_uring_enter(ringfd_, toSubmit, hasCompletions ? 0 : 1,
+                             IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    if(ret < 0 && errno != ETIME && errno != EINTR)
+    {
+        LOG_ERROR("IoUringPoller::poll() err:%d", errno);
+    }
+}
+
+void IoUringPoller::armPendingChannels()
+{
+    for(int fd : pendingArms_)
+    {
+        Channel *channel = findChannel(fd);
+        if(channel == nullptr || !slots_[fd].pendingArm)
+        {
+            continue; // 已经被删除了，或者重复的fd
+        }
+        Slot &slot = slots_[fd];
+        slot.pendingArm = false;
+        uint32_t events = static_cast<uint32_t>(channel->events());
+        if(slot.armedEvents == 0 && events != 0)
+        {
+            armPoll(fd, slot, events, channel->isEdgeTriggered());
+        }
+    }
+    pendingArms_.clear();
+}
+
+void IoUringPoller::armPoll(int fd, Slot &slot, uint32_t events, bool multishot)
+{
+    if(++nextGeneration_ == 0)
+    {
+        ++nextGeneration_; // generation 0 保留给KInternalTag
+    }
+    slot.generation = nextGeneration_;
+    slot.armedEvents = events;
+
+    // EPOLLIN/EPOLLPRI/EPOLLOUT和POLLIN/POLLPRI/POLLOUT的取值是一样的，可以直接用channel的events
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = makeUserData(fd, slot.generation);
+}
+
+void IoUringPoller::cancelPoll(int fd, Slot &slot)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, slot.generation);
+    sqe->user_data = KInternalTag;
+    slot.armedEvents = 0;
+}
+
+void IoUringPoller::scheduleArm(int fd, Slot &slot)
+{
+    if(!slot.pendingArm)
+    {
+        slot.pendingArm = true;
+        pendingArms_.push_back(fd);
+    }
+}
+
+// 填写活跃的连接
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    ++pollRound_;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for(;head != tail;++head)
+    {
+        const io_uring_cqe *cqe = &cqes_[head & cqMask_];
+        if(cqe->user_data == KInternalTag)
+        {
+            continue;
+        }
+
+        int fd = static_cast<int>(cqe->user_data >> 32);
+        uint32_t generation = static_cast<uint32_t>(cqe->user_data);
+        Channel *channel = findChannel(fd);
+        if(channel == nullptr || slots_[fd].generation != generation || slots_[fd].armedEvents == 0)
+        {
+            continue; // 已经取消的poll
+        }
+
+        Slot &slot = slots_[fd];
+        // poll请求本身失败了，当作fd出错处理
+        int revents = cqe->res < 0 ? static_cast<int>(EPOLLERR) : cqe->res;
+        if(slot.activeRound == pollRound_)
+        {
+            channel->set_revents(channel->revents() | revents); // 同一轮里multishot的多个cqe合并成一次
+        }
+        else
+        {
+            slot.activeRound = pollRound_;
+            channel->set_revents(revents);
+            activeChannels->push_back(channel);
+        }
+
+        if(!(cqe->flags & IORING_CQE_F_MORE))
+        {
+            // 一次性的poll(或者被内核终止的multishot poll)，下一轮需要重新提交
+            slot.armedEvents = 0;
+            scheduleArm(fd, slot);
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
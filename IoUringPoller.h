@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <linux/io_uring.h>
+
+class Channel;
+
+/**
+ * io_uring的使用
+ * io_uring_setup  创建sq/cq两个环形队列，mmap到用户空间
+ * 每个channel对应一个IORING_OP_POLL_ADD请求，poll完成(cqe)就相当于epoll_wait返回了一个事件
+ * io_uring_enter  一次系统调用既提交这一轮所有的poll请求，又等待完成事件
+ *
+ * 和EPollPoller一样是LT语义：poll请求是一次性的，channel处理完事件以后在下一轮poll里重新提交，
+ * 内核在提交poll的时候会先检查一次fd的状态，数据没读完就会立即再次完成
+ * epoll_ctl的add/mod/del全部变成sqe，合并到下一次io_uring_enter里面，不再单独发起系统调用
+ *
+ * 边缘触发的channel用multishot poll(IORING_POLL_ADD_MULTI)，只有fd状态变化的时候才会产生cqe，
+ * 一次提交以后一直有效，不需要每轮重新提交
+*/
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // 内核不支持io_uring(或者不支持IORING_FEAT_EXT_ARG)的时候返回false
+    bool valid() const { return ringfd_ >= 0; }
+
+    // 重写基类Poller的抽象方法
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+private:
+    static const unsigned KRingEntries = 4096;
+
+    // 每个注册到poller上的fd的状态
+    struct Slot
+    {
+        uint32_t generation; // 每次提交poll都换一个新的generation，用来过滤掉已经取消的poll的cqe
+        uint32_t armedEvents; // 内核中正在poll的事件，0表示没有在poll
+        bool pendingArm; // 是否已经在pendingArms_中，等待下一轮提交
+        uint64_t activeRound; // 最近一次被放进activeChannels的轮次，multishot在一轮里可能产生多个cqe
+    };
+
+    bool setupRing();
+    void unmapRing();
+
+    io_uring_sqe* getSqe();
+    // 提交sq中所有的请求，并最多等待timeoutMs毫秒直到至少有一个cqe
+    void submitAndWait(int timeoutMs);
+    void armPendingChannels();
+    void armPoll(int fd, Slot &slot, uint32_t events, bool multishot);
+    void cancelPoll(int fd, Slot &slot);
+    // 填写活跃的连接
+    void fillActiveChannels(ChannelList *activeChannels);
+    void scheduleArm(int fd, Slot &slot);
+
+    int ringfd_;
+    uint32_t nextGeneration_;
+    uint64_t pollRound_;
+
+    // 提交队列
+    void *sqRing_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *sqArray_;
+    io_uring_sqe *sqes_;
+    unsigned sqeTail_; // 本地的tail，提交的时候才写回sqTail_
+
+    // 完成队列
+    void *cqRing_;
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    std::vector<Slot> slots_; // 和channels_一样用fd做下标
+    std::vector<int> pendingArms_; // 下一轮poll需要(重新)提交poll请求的fd
+};
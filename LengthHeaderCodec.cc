@@ -0,0 +1,75 @@
+#include "LengthHeaderCodec.h"
+#include "TcpConnection.h"
+#include "Crc32c.h"
+#include "Logger.h"
+
+const size_t LengthHeaderCodec::KHeaderLen;
+const size_t LengthHeaderCodec::KChecksumLen;
+const size_t LengthHeaderCodec::KDefaultMaxFrameSize;
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    const size_t trailerLen = checksum_ ? KChecksumLen : 0;
+    while(buf->readableBytes() >= KHeaderLen)
+    {
+        const size_t len = static_cast<uint32_t>(buf->peekInt32());
+        if(len > maxFrameSize_)
+        {
+            LOG_ERROR("LengthHeaderCodec::onMessage [%s] invalid frame length %lu \n", conn->name().c_str(), len);
+            conn->forceClose();
+            return;
+        }
+        if(buf->readableBytes() < KHeaderLen + len + trailerLen) // 还不是一个完整的帧
+        {
+            return;
+        }
+
+        const char *body = buf->peek() + KHeaderLen;
+        if(checksum_)
+        {
+            uint32_t expected;
+            ::memcpy(&expected, body + len, sizeof expected);
+            if(Crc32c::value(body, len) != be32toh(expected))
+            {
+                LOG_ERROR("LengthHeaderCodec::onMessage [%s] checksum mismatch \n", conn->name().c_str());
+                conn->forceClose();
+                return;
+            }
+        }
+        frameCallback_(conn, body, len, receiveTime);
+        buf->retrieve(KHeaderLen + len + trailerLen);
+    }
+}
+
+void LengthHeaderCodec::encode(Buffer *buf) const
+{
+    size_t len = buf->readableBytes();
+    if(checksum_)
+    {
+        buf->appendInt32(static_cast<int32_t>(Crc32c::value(buf->peek(), len)));
+    }
+    buf->prependInt32(static_cast<int32_t>(len));
+}
+
+void LengthHeaderCodec::appendFrame(Buffer *out, const char *data, size_t len) const
+{
+    out->appendInt32(static_cast<int32_t>(len));
+    out->append(data, len);
+    if(checksum_)
+    {
+        out->appendInt32(static_cast<int32_t>(Crc32c::value(data, len)));
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len)
+{
+    Buffer buf;
+    appendFrame(&buf, data, len);
+    conn->send(&buf);
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf)
+{
+    encode(buf);
+    conn->send(buf);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <string>
+
+/**
+ * 长度头分帧  帧格式: [int32 长度(网络字节序)][消息体][可选: int32 消息体的CRC32C]
+ * 放在TcpConnection的messageCallback和用户代码之间：
+ * server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec, _1, _2, _3));
+ * onMessage把inputBuffer_中所有完整的帧依次回调给frameCallback，消息体直接指向inputBuffer_，不拷贝
+ * (只在回调期间有效)；长度超过maxFrameSize或者校验失败的连接直接关闭
+*/
+class LengthHeaderCodec : noncopyable
+{
+public:
+    using FrameCallback = std::function<void(const TcpConnectionPtr&, const char*, size_t, Timestamp)>;
+
+    static const size_t KHeaderLen = sizeof(int32_t);
+    static const size_t KChecksumLen = sizeof(int32_t);
+    static const size_t KDefaultMaxFrameSize = 64 * 1024 * 1024;
+
+    explicit LengthHeaderCodec(const FrameCallback &cb,
+                               size_t maxFrameSize = KDefaultMaxFrameSize,
+                               bool checksum = false)
+        : frameCallback_(cb)
+        , maxFrameSize_(maxFrameSize)
+        , checksum_(checksum)
+        {}
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    // 发送一帧  拷贝一次，加上长度头和校验
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len);
+    void send(const TcpConnectionPtr &conn, const std::string &message) { send(conn, message.data(), message.size()); }
+    // buf中所有可读的数据作为一帧，长度头写在prepend区，消息体不挪动、不拷贝  调用之后buf为空
+    void send(const TcpConnectionPtr &conn, Buffer *buf);
+
+    // 把buf中所有可读的数据作为消息体，原地加上长度头和校验，变成一个完整的帧
+    void encode(Buffer *buf) const;
+    // 把[data, data+len]编码成一帧追加到out的末尾  可以在一个Buffer里攒很多帧再一次发送
+    void appendFrame(Buffer *out, const char *data, size_t len) const;
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameSize_;
+    const bool checksum_;
+};
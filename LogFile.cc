@@ -0,0 +1,132 @@
+#include "LogFile.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// 这里不能用LOG_*，LogFile自己就是日志的输出端
+LogFile::LogFile(const std::string &basename,
+                off_t rollSize,
+                int flushInterval,
+                int rollInterval)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushInterval)
+    , rollInterval_(rollInterval)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+    , lastFlush_(0)
+    , writtenBytes_(0)
+    , fp_(nullptr)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if(fp_ != nullptr)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    if(fp_ == nullptr)
+    {
+        return;
+    }
+    size_t written = 0;
+    while(written < len)
+    {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if(n == 0)
+        {
+            int err = ::ferror(fp_);
+            if(err)
+            {
+                fprintf(stderr, "LogFile::append() failed %s\n", ::strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+
+    time_t now = ::time(NULL);
+    if(writtenBytes_ > rollSize_)
+    {
+        rollFile();
+    }
+    else if(now / rollInterval_ * rollInterval_ != startOfPeriod_)
+    {
+        rollFile();
+    }
+    else if(now - lastFlush_ >= flushInterval_)
+    {
+        lastFlush_ = now;
+        ::fflush(fp_);
+    }
+}
+
+void LogFile::flush()
+{
+    if(fp_ != nullptr)
+    {
+        ::fflush(fp_);
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = ::time(NULL);
+    if(now <= lastRoll_)
+    {
+        return false;
+    }
+    std::string filename = getLogFileName(basename_, now);
+    FILE *fp = ::fopen(filename.c_str(), "ae"); // e: O_CLOEXEC
+    if(fp == nullptr)
+    {
+        fprintf(stderr, "LogFile::rollFile() open %s failed %s\n", filename.c_str(), ::strerror(errno));
+        return false;
+    }
+    if(fp_ != nullptr)
+    {
+        ::fclose(fp_);
+    }
+    fp_ = fp;
+    ::setbuffer(fp_, buffer_, sizeof buffer_);
+    lastRoll_ = now;
+    lastFlush_ = now;
+    startOfPeriod_ = now / rollInterval_ * rollInterval_;
+    writtenBytes_ = 0;
+    return true;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t now)
+{
+    std::string filename(basename);
+
+    char timebuf[32];
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256];
+    if(::gethostname(hostname, sizeof hostname) == 0)
+    {
+        hostname[sizeof hostname - 1] = '\0';
+        filename += hostname;
+    }
+    else
+    {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
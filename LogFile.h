@@ -0,0 +1,49 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * 滚动的日志文件  AsyncLogging的后台线程用它写文件
+ * 文件名 basename.20260101-120000.hostname.pid.log
+ * 写满rollSize字节，或者进入新的rollInterval周期(默认按天，从UTC 0点算)的时候换一个新文件
+ * 距离上次fflush超过flushInterval秒的时候，append顺便fflush一次
+ * 不是线程安全的，只能在一个线程里用
+*/
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int flushInterval = 3,
+            int rollInterval = 60 * 60 * 24);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    // 换一个新文件  同一秒里已经换过的话文件名会重复，返回false
+    bool rollFile();
+
+    off_t writtenBytes() const { return writtenBytes_; }
+
+private:
+    static const size_t KFileBufferSize = 64 * 1024; // stdio缓冲区
+
+    static std::string getLogFileName(const std::string &basename, time_t now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int rollInterval_;
+
+    time_t startOfPeriod_; // 当前文件所在的rollInterval周期的开始时间
+    time_t lastRoll_;
+    time_t lastFlush_;
+    off_t writtenBytes_; // 当前文件已经写的字节数
+    FILE *fp_;
+    char buffer_[KFileBufferSize];
+};
@@ -1,7 +1,30 @@
-#include "logger.h"
+#include "Logger.h"
 #include "Timestamp.h"
 
-#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+const size_t Logger::KMaxLineSize;
+
+std::atomic_int Logger::minLevel_(MUDUO_MIN_LOG_LEVEL);
+
+// 每个线程缓存的日期 "2026/01/02 03:04:05 : "  t_lastSecond变了才重新localtime_r
+static __thread time_t t_lastSecond = -1;
+static __thread char t_date[32];
+static __thread size_t t_dateLen = 0;
+
+static void defaultOutput(const char *msg, size_t len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+    ::fflush(stdout);
+}
 
 // 获取日志唯一的实例对象
 Logger& Logger::instance()
@@ -10,32 +33,142 @@ Logger& Logger::instance()
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level)
+Logger::Logger()
+    : output_(defaultOutput)
+    , flush_(defaultFlush)
+    , binary_(false)
 {
-    logLevel_ = level;
 }
 
-// 写日志 [级别信息] time : msg 
-void Logger::log(std::string msg)
+const char* Logger::levelName(int level)
 {
-    switch(logLevel_)
+    switch(level)
     {
+        case DEBUG:
+            return "[DEBUG]";
         case INFO:
-            std::cout << "[INFO]";
-            break;
+            return "[INFO]";
         case ERROR:
-            std::cout << "[ERROR]";
-            break;
+            return "[ERROR]";
         case FATAL:
-            std::cout << "[FATAL]";
-            break;
-        case DEBUG:
-            std::cout << "[DEBUG]";
+            return "[FATAL]";
         default:
-            break;
+            return "";
+    }
+}
+
+void Logger::setOutput(OutputFunc out)
+{
+    output_ = std::move(out);
+}
+
+void Logger::setFlush(FlushFunc flush)
+{
+    flush_ = std::move(flush);
+}
+
+size_t Logger::formatPrefix(int level, char *buf, size_t size)
+{
+    // 只要秒，不用读精确的时钟
+    time_t seconds = Timestamp::nowCoarse().secondsSinceEpoch();
+    if(seconds != t_lastSecond)
+    {
+        struct tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        int n = snprintf(t_date, sizeof t_date, "%4d/%02d/%02d %02d:%02d:%02d : ",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+        if(n < 0 || static_cast<size_t>(n) >= sizeof t_date)
+        {
+            return 0;
+        }
+        t_dateLen = n;
+        t_lastSecond = seconds;
     }
 
-    // 打印时间和msg
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+    const char *name = levelName(level);
+    size_t nameLen = ::strlen(name);
+    if(nameLen + t_dateLen >= size)
+    {
+        return 0;
+    }
+    ::memcpy(buf, name, nameLen);
+    ::memcpy(buf + nameLen, t_date, t_dateLen);
+    return nameLen + t_dateLen;
+}
+
+int64_t Logger::now()
+{
+    return Timestamp::now().microSecondsSinceEpoch();
+}
+
+// 写日志 [级别信息] time : msg 
+void Logger::logText(int level, const char *format, ...)
+{
+    // 一整行拼好之后交给输出端一次写出去，多个线程的日志不会交错
+    // 不用清零，snprintf/vsnprintf会写结尾的'\0'
+    char line[KMaxLineSize];
+    size_t prefix = formatPrefix(level, line, sizeof line);
+    if(prefix == 0)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + prefix, sizeof line - prefix, format, args);
+    va_end(args);
+    if(n < 0)
+    {
+        return;
+    }
+    size_t len = prefix + n;
+    if(len >= sizeof line - 1) // 被截断了，留一个字节给换行
+    {
+        len = sizeof line - 2;
+    }
+    // 格式串自己带的换行和空格去掉，每条日志一行
+    while(len > static_cast<size_t>(prefix) && (line[len - 1] == '\n' || line[len - 1] == ' '))
+    {
+        len--;
+    }
+    line[len++] = '\n';
+    output(level, line, len);
+}
+
+uint32_t Logger::registerFormat(std::atomic<uint32_t> *formatId, const char *format)
+{
+    static std::mutex mutex;
+    static uint32_t nextId = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    uint32_t id = formatId->load(std::memory_order_relaxed);
+    if(id != 0) // 别的线程已经登记过了
+    {
+        return id;
+    }
+    id = ++nextId;
+    // 格式串记录要在所有用到这个id的日志记录之前输出
+    char record[KMaxLineSize + 64];
+    BinaryLogWriter writer(record, sizeof record);
+    writer.appendFormat(id, format);
+    if(!writer.overflow())
+    {
+        output_(record, writer.length());
+    }
+    formatId->store(id, std::memory_order_release);
+    return id;
+}
+
+void Logger::output(int level, const char *msg, size_t len)
+{
+    output_(msg, len);
+    if(level == FATAL)
+    {
+        flush_();
+    }
+}
@@ -1,65 +1,78 @@
 #pragma once
 
 #include <string>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
 
 #include "noncopyable.h"
+#include "BinaryLog.h"
 
-// LOG_INFO("%s, %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    }while(0)
+// 定义日志的级别  从低到高
+enum LogLevel
+{
+    DEBUG, // 调试信息
+    INFO, //普通信息
+    ERROR, // 错误信息
+    FATAL, // core信息
+};
 
-#define LOG_ERROR(logmsgFormat, ...) \
+/**
+ * 编译期的最低日志级别  0:DEBUG 1:INFO 2:ERROR
+ * 低于它的LOG_*展开为空，参数也不会求值  -DMUDUO_MIN_LOG_LEVEL=2 可以把库里所有的LOG_INFO都去掉
+ * 调试信息会很多，一般运行起来，都是关闭的  定义了MUDEBUG才编译LOG_DEBUG
+*/
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL 0
+#else
+#define MUDUO_MIN_LOG_LEVEL 1
+#endif
+#endif
+
+/**
+ * 先检查运行时的最低级别，关闭的级别只有一次比较，不做任何格式化
+ * 级别跟着每一条记录传给Logger::log，不再改单例里的状态，多个线程同时写日志不会串级别
+ * 每个调用点有一个自己的格式串id，二进制格式用
+ * if(false)那一句只是让编译器照printf检查格式串和参数，不会执行
+*/
+#define MUDUO_LOG(level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if(Logger::isEnabled(level)) \
+        { \
+            static std::atomic<uint32_t> muduoLogFormatId(0); \
+            if(false) Logger::checkFormat(logmsgFormat, ##__VA_ARGS__); \
+            Logger::instance().log(level, &muduoLogFormatId, logmsgFormat, ##__VA_ARGS__); \
+        } \
     }while(0)
 
+// LOG_INFO("%s, %d", arg1, arg2)
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...)
+#endif
+
 #define LOG_FATAL(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        MUDUO_LOG(FATAL, logmsgFormat, ##__VA_ARGS__); \
         exit(-1); \
     }while(0)
 
-//调试信息会很多，一般运行起来，都是关闭的
-// 定义了MUDEBUG就输出，不定义就不输出
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    }while(0)
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG(DEBUG, logmsgFormat, ##__VA_ARGS__)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...)
-#endif    
-
-// 定义日志的级别 INFO ERROR FATAL DEBUG
-enum LogLevel
-{
-    INFO, //普通信息
-    ERROR, // 错误信息
-    FATAL, // core信息
-    DEBUG, // 调试信息
-};
+#define LOG_DEBUG(logmsgFormat, ...)
+#endif
 
 // 输出一个日志类
 class Logger : noncopyable
@@ -68,11 +81,77 @@ public:
     // 获取日志唯一的实例对象
     static Logger& instance();
 
-    // 设置日志级别
-    void setLogLevel(int level);
+    // 运行时的最低日志级别，默认是编译期的最低级别  可以在任何线程随时修改
+    static void setLogLevel(int level) { minLevel_.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return minLevel_.load(std::memory_order_relaxed); }
+    static bool isEnabled(int level)
+    {
+        return __builtin_expect(level >= minLevel_.load(std::memory_order_relaxed), 0);
+    }
+
+    static const char* levelName(int level);
+    /**
+     * 文本日志的行首 "[INFO]2026/01/02 03:04:05 : "，返回长度，buf不够返回0
+     * 日期只精确到秒，每个线程缓存当前这一秒的日期字符串，一秒只格式化一次
+    */
+    static size_t formatPrefix(int level, char *buf, size_t size);
+
+    // 只用来让编译器检查格式串
+    __attribute__((format(printf, 1, 2))) static void checkFormat(const char *, ...) {}
+
+    // 写日志  由LOG_*调用
+    template <typename... Args>
+    void log(int level, std::atomic<uint32_t> *formatId, const char *format, const Args&... args)
+    {
+        if(binary_)
+        {
+            uint32_t id = formatId->load(std::memory_order_acquire);
+            if(id == 0)
+            {
+                id = registerFormat(formatId, format);
+            }
+            char record[KMaxLineSize];
+            BinaryLogWriter writer(record, sizeof record);
+            writer.appendRecord(id, level, now(), args...);
+            if(!writer.overflow())
+            {
+                output(level, record, writer.length());
+            }
+        }
+        else
+        {
+            logText(level, format, args...);
+        }
+    }
 
-    // 写日志
-    void log(std::string msg);
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+    /**
+     * 日志的输出端，默认写到stdout(不是每一行都flush)
+     * 换成AsyncLogging::append之后，写日志的线程只做一次内存拷贝，由后台线程批量写文件
+     * 需要在其它线程开始写日志之前设置
+    */
+    void setOutput(OutputFunc out);
+    // LOG_FATAL退出进程之前调用
+    void setFlush(FlushFunc flush);
+    /**
+     * 二进制格式  不格式化，只输出格式串id和参数的原始值(见BinaryLog.h)，用BinaryLogDecoder离线还原成文本
+     * 需要在其它线程开始写日志之前设置，输出端最好是文件(AsyncLogging)
+    */
+    void setBinaryFormat(bool on) { binary_ = on; }
 private:
-    int logLevel_;
+    static const size_t KMaxLineSize = 1200;
+
+    Logger();
+
+    void logText(int level, const char *format, ...);
+    uint32_t registerFormat(std::atomic<uint32_t> *formatId, const char *format);
+    void output(int level, const char *msg, size_t len);
+    static int64_t now();
+
+    static std::atomic_int minLevel_;
+
+    OutputFunc output_;
+    FlushFunc flush_;
+    bool binary_;
 };
@@ -0,0 +1,136 @@
+#include "LoopMetrics.h"
+
+#include <math.h>
+
+const int LatencyHistogram::KSubBucketBits;
+const int LatencyHistogram::KSubBuckets;
+const int LatencyHistogram::KMaxValueBits;
+const int LatencyHistogram::KNumBuckets;
+
+LatencyHistogram::LatencyHistogram()
+    : sum_(0)
+    , max_(0)
+{
+    for(std::atomic<uint64_t> &count : counts_)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * [0, 16)每个值一个桶
+ * [2^k, 2^(k+1)) (k >= 4)分成16个桶，每个桶宽2^(k-4)
+*/
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if(value < static_cast<uint64_t>(KSubBuckets))
+    {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    if(msb >= KMaxValueBits)
+    {
+        return KNumBuckets - 1;
+    }
+    int shift = msb - KSubBucketBits;
+    return (shift + 1) * KSubBuckets + static_cast<int>((value >> shift) - KSubBuckets);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if(index < KSubBuckets)
+    {
+        return index;
+    }
+    int shift = index / KSubBuckets - 1;
+    uint64_t lower = static_cast<uint64_t>(KSubBuckets + index % KSubBuckets) << shift;
+    return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
+
+void LatencyHistogram::snapshot(Snapshot *snap) const
+{
+    snap->counts.resize(KNumBuckets);
+    snap->count = 0;
+    for(int i = 0;i < KNumBuckets;i++)
+    {
+        snap->counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snap->count += snap->counts[i];
+    }
+    snap->sum = sum_.load(std::memory_order_relaxed);
+    snap->max = max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double p) const
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(::ceil(p / 100.0 * count));
+    if(target == 0)
+    {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for(size_t i = 0;i < counts.size();i++)
+    {
+        seen += counts[i];
+        if(seen >= target)
+        {
+            uint64_t upper = bucketUpperBound(static_cast<int>(i));
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+LoopMetrics::LoopMetrics()
+    : iterations_(0)
+    , events_(0)
+    , functors_(0)
+    , pollWaitNs_(0)
+    , busyNs_(0)
+{
+}
+
+void LoopMetrics::recordPoll(int64_t waitNs, size_t numEvents)
+{
+    uint64_t wait = waitNs > 0 ? waitNs : 0;
+    increment(pollWaitNs_, wait);
+    pollWait_.record(wait);
+    if(numEvents > 0)
+    {
+        increment(events_, numEvents);
+        eventsPerWakeup_.record(numEvents);
+    }
+}
+
+void LoopMetrics::recordFunctors(size_t queueDepth, size_t executed)
+{
+    if(executed > 0)
+    {
+        increment(functors_, executed);
+        functorQueueDepth_.record(queueDepth);
+    }
+}
+
+void LoopMetrics::recordIteration(int64_t busyNs)
+{
+    uint64_t busy = busyNs > 0 ? busyNs : 0;
+    increment(iterations_, 1);
+    increment(busyNs_, busy);
+    loopLag_.record(busy);
+}
+
+void LoopMetrics::snapshot(Snapshot *snap) const
+{
+    snap->iterations = iterations_.load(std::memory_order_relaxed);
+    snap->events = events_.load(std::memory_order_relaxed);
+    snap->functors = functors_.load(std::memory_order_relaxed);
+    snap->pollWaitNs = pollWaitNs_.load(std::memory_order_relaxed);
+    snap->busyNs = busyNs_.load(std::memory_order_relaxed);
+    loopLag_.snapshot(&snap->loopLag);
+    pollWait_.snapshot(&snap->pollWait);
+    eventsPerWakeup_.snapshot(&snap->eventsPerWakeup);
+    functorQueueDepth_.snapshot(&snap->functorQueueDepth);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Clock.h"
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * HDR风格的直方图  对数-线性分桶：每个2的幂区间再等分成KSubBuckets份，相对误差不超过1/KSubBuckets
+ * 只能有一个线程record(loop线程)，计数都是relaxed的原子变量，任何线程都可以随时snapshot，不需要加锁，也不会让写的一方变慢
+ * snapshot不是一个原子的快照，各个桶之间可能差几次record，监控够用了
+*/
+class LatencyHistogram : noncopyable
+{
+public:
+    static const int KSubBucketBits = 4;
+    static const int KSubBuckets = 1 << KSubBucketBits; // 每个2的幂区间16个桶  误差6.25%
+    static const int KMaxValueBits = 40; // 超过2^40(ns就是18分钟)的值记在最后一个桶
+    static const int KNumBuckets = (KMaxValueBits - KSubBucketBits + 1) * KSubBuckets;
+
+    struct Snapshot
+    {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0; }
+        // p in [0, 100]  返回所在桶的上界
+        uint64_t percentile(double p) const;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value)
+    {
+        increment(counts_[bucketIndex(value)], 1);
+        increment(sum_, value);
+        if(value > max_.load(std::memory_order_relaxed))
+        {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void snapshot(Snapshot *snap) const;
+
+    static int bucketIndex(uint64_t value);
+    // 桶中最大的值
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    // 只有一个写者，不需要fetch_add的lock前缀
+    static void increment(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts_[KNumBuckets];
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+ * 一个EventLoop的运行指标  由loop线程在每一轮循环里更新
+ * loopLag: poll返回到处理完所有活跃channel和回调的时间，也就是一个刚到的事件最坏要等多久才会被poll到  超过SLO说明loop饱和了
+ * pollWait: 阻塞在poll里的时间
+ * eventsPerWakeup: 每次poll返回的活跃channel数(不算超时返回的)
+ * functorQueueDepth: 有回调要执行的那些轮，开始执行的时候pendingFunctors_中排队的回调数
+ * 时间的单位都是ns
+*/
+class LoopMetrics : noncopyable
+{
+public:
+    struct Snapshot
+    {
+        uint64_t iterations = 0;
+        uint64_t events = 0;
+        uint64_t functors = 0;
+        uint64_t pollWaitNs = 0;
+        uint64_t busyNs = 0;
+        int connections = 0; // 当前的连接数
+        int pendingFunctors = 0; // 当前排队的回调数
+        LatencyHistogram::Snapshot loopLag;
+        LatencyHistogram::Snapshot pollWait;
+        LatencyHistogram::Snapshot eventsPerWakeup;
+        LatencyHistogram::Snapshot functorQueueDepth;
+
+        // 处理事件的时间占比  接近1说明这个loop已经没有余量了
+        double utilization() const
+        {
+            uint64_t total = pollWaitNs + busyNs;
+            return total > 0 ? static_cast<double>(busyNs) / total : 0;
+        }
+    };
+
+    LoopMetrics();
+
+    // 每一轮循环读两次，只用来算时间差，用TscClock
+    static int64_t nowNs() { return TscClock::nowNs(); }
+
+    // 以下由loop线程调用
+    void recordPoll(int64_t waitNs, size_t numEvents);
+    void recordFunctors(size_t queueDepth, size_t executed);
+    void recordIteration(int64_t busyNs);
+
+    // 任何线程都可以调用  connections/pendingFunctors由EventLoop填
+    void snapshot(Snapshot *snap) const;
+
+private:
+    static void increment(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> iterations_;
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> functors_;
+    std::atomic<uint64_t> pollWaitNs_;
+    std::atomic<uint64_t> busyNs_;
+    LatencyHistogram loopLag_;
+    LatencyHistogram pollWait_;
+    LatencyHistogram eventsPerWakeup_;
+    LatencyHistogram functorQueueDepth_;
+};
@@ -0,0 +1,291 @@
+#include "MetricsServer.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "LoopMetrics.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <future>
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t MetricsServer::KDefaultTopConnections;
+const size_t MetricsServer::KMaxRequestSize;
+
+MetricsServer::MetricsServer(const InetAddress &listenAddr, const std::string &name)
+    : listenAddr_(listenAddr)
+    , name_(name)
+    , loopThread_(EventLoopThread::ThreadInitCallback(), name)
+    , loop_(nullptr)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    if(loop_ != nullptr)
+    {
+        // server_的acceptor和连接要在loop_线程里销毁，然后loopThread_退出loop
+        std::promise<void> destroyed;
+        loop_->runInLoop([this, &destroyed]() {
+            server_.reset();
+            destroyed.set_value();
+        });
+        destroyed.get_future().wait();
+    }
+}
+
+void MetricsServer::start()
+{
+    if(loop_ != nullptr)
+    {
+        return;
+    }
+    loop_ = loopThread_.startLoop();
+    std::promise<void> started;
+    loop_->runInLoop([this, &started]() {
+        startInLoop();
+        started.set_value();
+    });
+    started.get_future().wait();
+}
+
+void MetricsServer::startInLoop()
+{
+    server_.reset(new TcpServer(loop_, listenAddr_, name_));
+    server_->setConnectionCallback([](const TcpConnectionPtr &) {});
+    server_->setMessageCallback(std::bind(&MetricsServer::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    server_->start(); // 没有subloop，连接都在loop_上
+    LOG_INFO("MetricsServer %s listening on %s \n", name_.c_str(), listenAddr_.toIpPort().c_str());
+}
+
+void MetricsServer::reply(const TcpConnectionPtr &conn, const char *status, const std::string &body)
+{
+    char header[256];
+    snprintf(header, sizeof header,
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n\r\n",
+        status, body.size());
+    std::string response(header);
+    response.append(body);
+    conn->send(std::move(response));
+    conn->shutdown();
+}
+
+// 只解析请求行，够Prometheus和curl用了
+void MetricsServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    const char KEnd[] = "\r\n\r\n";
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *headerEnd = std::search(begin, end, KEnd, KEnd + 4);
+    if(headerEnd == end)
+    {
+        if(buf->readableBytes() > KMaxRequestSize)
+        {
+            buf->retrieveAll();
+            reply(conn, "431 Request Header Fields Too Large", "request too large\n");
+        }
+        return; // 请求头还没收全
+    }
+
+    std::string requestLine(begin, std::find(begin, headerEnd, '\r'));
+    buf->retrieveAll();
+
+    // GET /path?query HTTP/1.1
+    size_t methodEnd = requestLine.find(' ');
+    size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : requestLine.find(' ', methodEnd + 1);
+    if(pathEnd == std::string::npos || requestLine.compare(0, methodEnd, "GET") != 0)
+    {
+        reply(conn, "400 Bad Request", "only GET is supported\n");
+        return;
+    }
+    std::string target = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    std::string path = target.substr(0, target.find('?'));
+    std::string query = path.size() < target.size() ? target.substr(path.size() + 1) : std::string();
+
+    if(path == "/metrics")
+    {
+        reply(conn, "200 OK", renderPrometheus());
+    }
+    else if(path == "/connections")
+    {
+        size_t topN = KDefaultTopConnections;
+        size_t pos = query.find("top=");
+        if(pos != std::string::npos)
+        {
+            topN = static_cast<size_t>(::strtoul(query.c_str() + pos + 4, nullptr, 10));
+        }
+        reply(conn, "200 OK", renderConnections(topN));
+    }
+    else
+    {
+        reply(conn, "404 Not Found", "try /metrics or /connections?top=N\n");
+    }
+}
+
+static void appendFamily(std::string *out, const char *metric, const char *type, const char *help)
+{
+    char buf[256];
+    snprintf(buf, sizeof buf, "# HELP mymuduo_%s %s\n# TYPE mymuduo_%s %s\n", metric, help, metric, type);
+    out->append(buf);
+}
+
+static void appendSample(std::string *out, const char *metric, const std::string &labels, double value)
+{
+    char buf[512];
+    snprintf(buf, sizeof buf, "mymuduo_%s{%s} %.9g\n", metric, labels.c_str(), value);
+    out->append(buf);
+}
+
+// 每个server的一个计数
+struct ServerSample
+{
+    const char *metric;
+    const char *type;
+    const char *help;
+    double (*value)(const TcpServer::Stats &s);
+};
+
+static const ServerSample KServerSamples[] = {
+    {"connections_accepted_total", "counter", "Connections accepted.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.connectionsAccepted); }},
+    {"connections_closed_total", "counter", "Connections closed.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.connectionsClosed); }},
+    {"connections_active", "gauge", "Connections currently open.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.activeConnections); }},
+    {"accept_errors_total", "counter", "accept() failures other than EAGAIN.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.acceptErrors); }},
+    {"bytes_received_total", "counter", "Bytes read from connections.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.bytesReceived); }},
+    {"bytes_sent_total", "counter", "Bytes written to connections.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.bytesSent); }},
+    {"messages_received_total", "counter", "Message callbacks invoked.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.messagesReceived); }},
+    {"messages_sent_total", "counter", "send() calls on connections.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.messagesSent); }},
+    {"high_water_mark_hits_total", "counter", "Output buffers crossing the high water mark.",
+        [](const TcpServer::Stats &s) { return static_cast<double>(s.highWaterMarkHits); }},
+};
+
+// 每个loop的一个指标，时间换算成秒
+struct LoopSample
+{
+    const char *metric;
+    const char *type;
+    const char *help;
+    double (*value)(const LoopMetrics::Snapshot &s);
+};
+
+static const LoopSample KLoopSamples[] = {
+    {"loop_iterations_total", "counter", "Event loop iterations.",
+        [](const LoopMetrics::Snapshot &s) { return static_cast<double>(s.iterations); }},
+    {"loop_events_total", "counter", "Active channels returned by poll.",
+        [](const LoopMetrics::Snapshot &s) { return static_cast<double>(s.events); }},
+    {"loop_functors_total", "counter", "Queued functors executed.",
+        [](const LoopMetrics::Snapshot &s) { return static_cast<double>(s.functors); }},
+    {"loop_busy_seconds_total", "counter", "Time spent handling events and functors.",
+        [](const LoopMetrics::Snapshot &s) { return s.busyNs / 1e9; }},
+    {"loop_poll_wait_seconds_total", "counter", "Time spent blocked in poll.",
+        [](const LoopMetrics::Snapshot &s) { return s.pollWaitNs / 1e9; }},
+    {"loop_connections", "gauge", "Connections owned by the loop.",
+        [](const LoopMetrics::Snapshot &s) { return static_cast<double>(s.connections); }},
+    {"loop_pending_functors", "gauge", "Functors waiting in the loop queue.",
+        [](const LoopMetrics::Snapshot &s) { return static_cast<double>(s.pendingFunctors); }},
+};
+
+static const double KQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+std::string MetricsServer::renderPrometheus()
+{
+    std::vector<TcpServer::Stats> stats(servers_.size());
+    std::vector<std::vector<LoopMetrics::Snapshot>> loops(servers_.size());
+    std::vector<std::string> labels(servers_.size());
+    for(size_t i = 0;i < servers_.size();i++)
+    {
+        servers_[i]->stats(&stats[i]);
+        loops[i] = servers_[i]->threadPool()->metricsSnapshot();
+        labels[i] = "server=\"" + servers_[i]->name() + "\"";
+    }
+
+    std::string out;
+    for(const ServerSample &sample : KServerSamples)
+    {
+        appendFamily(&out, sample.metric, sample.type, sample.help);
+        for(size_t i = 0;i < servers_.size();i++)
+        {
+            appendSample(&out, sample.metric, labels[i], sample.value(stats[i]));
+        }
+    }
+
+    for(const LoopSample &sample : KLoopSamples)
+    {
+        appendFamily(&out, sample.metric, sample.type, sample.help);
+        for(size_t i = 0;i < servers_.size();i++)
+        {
+            for(size_t j = 0;j < loops[i].size();j++)
+            {
+                appendSample(&out, sample.metric, labels[i] + ",loop=\"" + std::to_string(j) + "\"",
+                    sample.value(loops[i][j]));
+            }
+        }
+    }
+
+    // loop lag的分位数  LatencyHistogram的桶上界，误差不超过6.25%
+    appendFamily(&out, "loop_lag_seconds", "summary", "Time from poll return to the end of the iteration.");
+    for(size_t i = 0;i < servers_.size();i++)
+    {
+        for(size_t j = 0;j < loops[i].size();j++)
+        {
+            const LatencyHistogram::Snapshot &lag = loops[i][j].loopLag;
+            std::string loopLabels = labels[i] + ",loop=\"" + std::to_string(j) + "\"";
+            for(double q : KQuantiles)
+            {
+                char quantile[32];
+                snprintf(quantile, sizeof quantile, ",quantile=\"%g\"", q);
+                appendSample(&out, "loop_lag_seconds", loopLabels + quantile, lag.percentile(q * 100) / 1e9);
+            }
+            appendSample(&out, "loop_lag_seconds_sum", loopLabels, lag.sum / 1e9);
+            appendSample(&out, "loop_lag_seconds_count", loopLabels, static_cast<double>(lag.count));
+        }
+    }
+    return out;
+}
+
+std::string MetricsServer::renderConnections(size_t topN)
+{
+    std::string out;
+    char line[512];
+    for(TcpServer *server : servers_)
+    {
+        TcpServer::Stats stats;
+        server->stats(&stats);
+        std::vector<TcpConnection::Stats> conns = server->topConnections(topN);
+        snprintf(line, sizeof line, "server %s %s  active=%zu  top %zu by bytes\n",
+            server->name().c_str(), server->ipPort().c_str(), stats.activeConnections, conns.size());
+        out.append(line);
+        snprintf(line, sizeof line, "%-40s %-21s %10s %14s %14s %10s %10s %10s %10s %5s\n",
+            "name", "peer", "age(s)", "bytes in", "bytes out", "msgs in", "msgs out", "inbuf", "outbuf", "hwm");
+        out.append(line);
+        for(const TcpConnection::Stats &c : conns)
+        {
+            snprintf(line, sizeof line, "%-40s %-21s %10.1f %14llu %14llu %10llu %10llu %10zu %10zu %5llu\n",
+                c.name.c_str(), c.peer.c_str(), c.ageUs / 1e6,
+                static_cast<unsigned long long>(c.bytesReceived),
+                static_cast<unsigned long long>(c.bytesSent),
+                static_cast<unsigned long long>(c.messagesReceived),
+                static_cast<unsigned long long>(c.messagesSent),
+                c.inputBufferBytes, c.outputBufferBytes,
+                static_cast<unsigned long long>(c.highWaterMarkHits));
+            out.append(line);
+        }
+        out.push_back('\n');
+    }
+    return out;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "EventLoopThread.h"
+#include "Callbacks.h"
+#include "Timestamp.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TcpServer;
+class Buffer;
+
+/**
+ * 内置的指标导出服务  在自己的loop线程上监听一个单独的端口，抓取指标不占用业务loop
+ * GET /metrics              Prometheus文本格式: 各个TcpServer的计数(TcpServer::Stats)和它的subloop的运行指标(LoopMetrics)
+ * GET /connections?top=N    纯文本: 每个TcpServer收发字节数最多的N个连接(默认20)的缓冲区大小、存活时间、收发字节数
+ * 每个请求回复之后关闭连接
+*/
+class MetricsServer : noncopyable
+{
+public:
+    static const size_t KDefaultTopConnections = 20;
+
+    explicit MetricsServer(const InetAddress &listenAddr, const std::string &name = "MetricsServer");
+    ~MetricsServer();
+
+    // 需要在start之前调用  server要比MetricsServer活得久，并且已经start了
+    void addServer(TcpServer *server) { servers_.push_back(server); }
+
+    // 启动自己的loop线程，在上面监听
+    void start();
+
+    // 两种输出，也可以不开端口，直接调用拿到文本
+    std::string renderPrometheus();
+    std::string renderConnections(size_t topN);
+private:
+    static const size_t KMaxRequestSize = 8 * 1024;
+
+    void startInLoop();
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    static void reply(const TcpConnectionPtr &conn, const char *status, const std::string &body);
+
+    const InetAddress listenAddr_;
+    const std::string name_;
+    EventLoopThread loopThread_;
+    EventLoop *loop_;
+    std::unique_ptr<TcpServer> server_; // 在loop_线程里创建和启动
+    std::vector<TcpServer*> servers_;
+};
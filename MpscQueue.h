@@ -0,0 +1,93 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <utility>
+
+/**
+ * 多生产者单消费者的无锁队列(Vyukov MPSC)
+ * 生产者: 任意线程调用push，一次原子exchange把节点挂到head_上，不会阻塞
+ * 不是侵入式的：push每次new一个Node把值包起来，consume取出值之后delete
+ * 消费者: 只能是一个线程(EventLoop所在的线程)，从tail_往后取
+ *
+ * tail_指向一个已经被取走值的"哨兵"节点，真正的数据从tail_->next开始
+ * push在exchange之后、链接next之前被打断时，消费者会暂时看不到这个节点以及它后面的节点，
+ * 下一次consume的时候就能取到
+*/
+template<typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(new Node)
+        , tail_(head_.load(std::memory_order_relaxed))
+        {}
+
+    ~MpscQueue()
+    {
+        T value;
+        while(pop(&value)) {}
+        delete tail_;
+    }
+
+    // 任意线程调用
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能在消费者线程调用
+    bool pop(T *value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if(next == nullptr)
+        {
+            return false;
+        }
+        *value = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        return true;
+    }
+
+    /**
+     * 只能在消费者线程调用
+     * 取出调用时刻已经在队列中的元素，逐个交给func，返回处理的个数
+     * func执行过程中新push进来的元素留到下一次consume，避免回调里不停地push导致一直退不出来
+    */
+    template<typename Func>
+    size_t consume(Func func)
+    {
+        Node *last = head_.load(std::memory_order_acquire);
+        size_t count = 0;
+        T value;
+        while(tail_ != last && pop(&value))
+        {
+            func(value);
+            ++count;
+        }
+        return count;
+    }
+
+    // 只是一个近似值，消费者线程调用时准确
+    bool empty() const
+    {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+private:
+    struct Node
+    {
+        Node() : next(nullptr) {}
+        explicit Node(T v) : next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    std::atomic<Node*> head_; // 生产者push的位置
+    Node *tail_; // 消费者pop的位置，只有消费者线程访问
+};
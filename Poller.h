@@ -4,7 +4,6 @@
 #include "Timestamp.h"
 
 #include <vector>
-#include <unordered_map>
 
 class Channel;
 class EventLoop;
@@ -29,9 +28,21 @@ public:
     // EventLoop可以通过改接口获取默认的I/O复用的具体实现
     static Poller* newDefaultPoller(EventLoop *loop);
 protected:
-    // key: sockfd    value: sockfd所属的channel通道类型
-    using ChannelMap = std::unordered_map<int, Channel*>;
+    /**
+     * 下标: sockfd    value: sockfd所属的channel通道类型，没有注册的fd是nullptr
+     * 内核总是分配最小的可用fd，fd是稠密的小整数，直接用fd做下标
+     * 注册/删除/查找channel都只是一次数组访问，没有哈希计算，也没有每个节点一次的内存分配
+    */
+    using ChannelMap = std::vector<Channel*>;
     ChannelMap channels_;
+    size_t numChannels_; // 当前注册的channel个数
+
+    Channel* findChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+    void addChannel(Channel *channel);
+    void eraseChannel(int fd);
 private:
     EventLoop *ownerLoop_; //定义Poller所属的事件循环EventLoop
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <stddef.h>
+
+/**
+ * 引用计数的只读数据片  拷贝Slice只增加引用计数，不拷贝数据
+ * 同一个Slice可以同时交给很多个连接发送(广播)，最后一个连接发送完之后数据才释放
+ * owner负责数据的生命周期，data/len指向owner持有的内存中的一段
+*/
+class Slice
+{
+public:
+    Slice()
+        : data_(nullptr)
+        , len_(0)
+        {}
+
+    // 接管str的内存，不拷贝
+    explicit Slice(std::string &&str)
+    {
+        std::shared_ptr<std::string> owner = std::make_shared<std::string>(std::move(str));
+        data_ = owner->data();
+        len_ = owner->size();
+        owner_ = std::move(owner);
+    }
+
+    // 拷贝一份[data, data+len]
+    Slice(const char *data, size_t len)
+        : Slice(std::string(data, len))
+        {}
+
+    // 外部的内存，owner保证它在Slice的生命周期内一直有效
+    Slice(const char *data, size_t len, std::shared_ptr<const void> owner)
+        : data_(data)
+        , len_(len)
+        , owner_(std::move(owner))
+        {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    const std::shared_ptr<const void>& owner() const { return owner_; }
+
+    // [offset, offset+len)的子片，和当前Slice共享同一个owner
+    Slice slice(size_t offset, size_t len) const
+    {
+        return Slice(data_ + offset, len, owner_);
+    }
+
+    std::string toString() const { return std::string(data_, len_); }
+private:
+    const char *data_;
+    size_t len_;
+    std::shared_ptr<const void> owner_;
+};
@@ -24,6 +24,10 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // SO_ZEROCOPY: 允许send的时候带MSG_ZEROCOPY  内核不支持返回false
+    bool setZeroCopy(bool on);
+    // SO_ATTACH_REUSEPORT_CBPF: 新连接交给reuseport组里第(收到SYN的CPU % groupSize)个socket
+    void setReusePortCpuSteering(int groupSize);
 private:
     const int sockfd_;
 };
\ No newline at end of file
@@ -3,14 +3,17 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "TcpRelay.h"
 
 #include <functional>
 #include <errno.h>
-#include <unistd>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <strings.h>
+#include <string.h>
 #include <netinet/tcp.h>
+#include <linux/errqueue.h>
 #include <string>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
@@ -23,7 +26,7 @@ static EventLoop* CheckLoopNotNull(EventLoop* loop)
     return loop;
 }
 
-TcpConnection::TcpConnection(EventLoop *loop
+TcpConnection::TcpConnection(EventLoop *loop,
                 const std::string &name,
                 int sockfd,
                 const InetAddress &localAddr,
@@ -32,11 +35,23 @@ TcpConnection::TcpConnection(EventLoop *loop
     , name_(name)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(socketfd))
-    , channel(new Channel(loop, sockfd))
+    , edgeTriggered_(false)
+    , zeroCopy_(false)
+    , cork_(false)
+    , flushPending_(false)
+    , socket_(new Socket(sockfd))
+    , channel_(new Channel(loop, sockfd))
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64*1024*1024) // 64M
+    , createTime_(Timestamp::nowCoarse())
+    , bytesReceived_(0)
+    , bytesSent_(0)
+    , messagesReceived_(0)
+    , messagesSent_(0)
+    , highWaterMarkHits_(0)
+    , inputBufferBytes_(0)
+    , outputBufferBytes_(0)
     {
         // 下面给channel设置相应的回调函数，poller给channel通知感兴趣的事件发生了，channel会回调相应的函数
         channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
@@ -46,6 +61,7 @@ TcpConnection::TcpConnection(EventLoop *loop
 
         LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name.c_str(), sockfd);
         socket_->setKeepAlive(true);
+        loop_->connectionAdded(); // 在connectDestroyed中减掉
     }
 
 TcpConnection::~TcpConnection()
@@ -62,17 +78,79 @@ void TcpConnection::send(const std::string &buf)
             sendInLoop(buf.c_str(), buf.size());
         }
         else
+        {
+            // buf在调用返回之后就可能失效了，拷贝一份交给loop线程
+            send(Slice(buf.data(), buf.size()));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&buf)
+{
+    if(state_ == kConnected)
+    {
+        if(loop_->isInLoopThread())
+        {
+            sendInLoop(buf.data(), buf.size());
+        }
+        else
+        {
+            send(Slice(std::move(buf)));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if(state_ == kConnected)
+    {
+        if(loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // 把buf的内存块移动到一个新的Buffer里，不拷贝数据
+            std::shared_ptr<Buffer> owner(new Buffer(std::move(*buf)));
+            send(Slice(owner->peek(), owner->readableBytes(), owner));
+        }
+    }
+}
+
+void TcpConnection::send(const Slice &slice)
+{
+    if(state_ == kConnected)
+    {
+        if(loop_->isInLoopThread())
+        {
+            sendSliceInLoop(slice);
+        }
+        else
         {
             loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
+                &TcpConnection::sendSliceInLoop,
+                shared_from_this(),
+                slice
             ));
         }
     }
 }
 
+void TcpConnection::sendSliceInLoop(const Slice &slice)
+{
+    if(slice.size() <= ChainBuffer::KMaxCopySliceSize)
+    {
+        // 小数据直接write，没写完的部分拷贝到outputBuffer_
+        sendInLoop(slice.data(), slice.size());
+        return;
+    }
+    // 大数据没写完的部分作为内存片挂在outputBuffer_上，不拷贝
+    ChainBuffer chain;
+    chain.appendSlice(slice);
+    sendChainInLoop(&chain);
+}
+
 /**
  * 发送数据 应用写得快，而内核发送数据慢，需要把待发送数据写入缓冲区，而且设置了水位回调
 */
@@ -88,13 +166,15 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         LOG_ERROR("disconnected, give up writing!");
         return;
     }
+    increment(messagesSent_, 1);
 
-    // 表示channel_第一次开始写数据，而且缓冲区没有待发送数据
-    if(!channel_->isWriteEvent() && outputBuffer_.readableBytes() == 0)
+    // 表示channel_第一次开始写数据，而且缓冲区没有待发送数据  cork模式下先攒着，这一轮结束的时候再发
+    if(!cork_ && !isWriting() && outputBuffer_.readableBytes() == 0)
     {
         nwrote = ::write(channel_->fd(), data, len);
         if(nwrote >= 0)
         {
+            increment(bytesSent_, nwrote);
             remaining = len - nwrote;
             if(remaining == 0 && writeCompleteCallback_)
             {
@@ -123,19 +203,240 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     {
         // 目前发送缓冲区剩余的待发送数据的长度
         size_t oldLen = outputBuffer_.readableBytes();
-        if(oldLen + remaining >= highWaterMark_
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
+        if(oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_)
+        {
+            increment(highWaterMarkHits_, 1); // 没有设置回调也计数
+            if(highWaterMarkCallback_)
+            {
+                loop_->queueInLoop(
+                    std::bind(highWaterMarkCallback_, shared_from_this(), oldLen+remaining)
+                );
+            }
+        }
+        outputBuffer_.append((char*)data+nwrote, remaining);
+        if(cork_)
+        {
+            scheduleFlush();
+        }
+        else if(!channel_->isWriteEvent()) // ET模式下EPOLLOUT一直是注册着的
+        {
+            channel_->enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+        }
+    }
+}
+
+void TcpConnection::send(ChainBuffer *buf)
+{
+    if(state_ == kConnected)
+    {
+        if(loop_->isInLoopThread())
+        {
+            sendChainInLoop(buf);
+        }
+        else
+        {
+            // 内存段先移动到一个新的ChainBuffer里，再交给loop线程
+            std::shared_ptr<ChainBuffer> chain(new ChainBuffer());
+            chain->append(*buf);
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendChainPtrInLoop,
+                shared_from_this(),
+                chain
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+    if(state_ == kConnected)
+    {
+        int dupFd = ::dup(fd); // 调用者可以马上close(fd)，dupFd在发送完之后由outputBuffer_关闭
+        if(dupFd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFile dup fd=%d errno:%d \n", fd, errno);
+            return;
+        }
+        if(loop_->isInLoopThread())
+        {
+            sendFileInLoop(dupFd, offset, length);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendFileInLoop,
+                shared_from_this(),
+                dupFd,
+                offset,
+                length
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+    ChainBuffer file;
+    file.appendFile(fd, offset, length); // 连接已经断开的时候，file析构会close(fd)
+    sendChainInLoop(&file);
+}
+
+void TcpConnection::sendChainInLoop(ChainBuffer *buf)
+{
+    if(state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+    increment(messagesSent_, 1);
+
+    size_t oldLen = outputBuffer_.readableBytes();
+    bool idle = !cork_ && !isWriting() && oldLen == 0;
+    outputBuffer_.append(*buf);
+
+    // 缓冲区原来没有待发送的数据，直接writev一次
+    if(idle)
+    {
+        int savedErrno = 0;
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        if(n >= 0)
+        {
+            increment(bytesSent_, n);
+            outputBuffer_.retrieve(n);
+            if(outputBuffer_.readableBytes() == 0)
+            {
+                if(writeCompleteCallback_)
+                {
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+                return;
+            }
+        }
+        else if(savedErrno != EWOULDBLOCK)
+        {
+            LOG_ERROR("TcpConnection::sendChainInLoop");
+            if(savedErrno == EPIPE || savedErrno == ECONNRESET)
+            {
+                outputBuffer_.retrieveAll();
+                return;
+            }
+            if(savedErrno == EIO)
+            {
+                abortWrite();
+                return;
+            }
+        }
+    }
+
+    // 剩下的数据留在outputBuffer_中，等EPOLLOUT
+    size_t newLen = outputBuffer_.readableBytes();
+    if(newLen >= highWaterMark_ && oldLen < highWaterMark_)
+    {
+        increment(highWaterMarkHits_, 1);
+        if(highWaterMarkCallback_)
         {
             loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen+remaining)
+                std::bind(highWaterMarkCallback_, shared_from_this(), newLen)
             );
         }
-        outputBuffer_.append((char*)data+nwrote, remaining);
+    }
+    if(cork_)
+    {
+        scheduleFlush();
+    }
+    else if(!channel_->isWriteEvent())
+    {
+        channel_->enableWriting();
+    }
+}
+
+void TcpConnection::setCork(bool on)
+{
+    bool wasCorked = cork_;
+    cork_ = on;
+    if(wasCorked && !on)
+    {
+        flushInLoop();
+    }
+}
+
+void TcpConnection::flush()
+{
+    if(loop_->isInLoopThread())
+    {
+        flushInLoop();
+    }
+    else
+    {
+        loop_->queueInLoop(std::bind(&TcpConnection::flushInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+}
+
+void TcpConnection::scheduleFlush()
+{
+    if(!flushPending_)
+    {
+        flushPending_ = true;
+        // 在loop线程里queueInLoop不会唤醒loop，这一轮处理完活跃的channel之后的doPendingFunctors里执行
+        loop_->queueInLoop(std::bind(&TcpConnection::flushInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::flushInLoop()
+{
+    flushPending_ = false;
+    if(state_ == kDisconnected || relay_ || outputBuffer_.readableBytes() == 0)
+    {
+        return;
+    }
+    if(!edgeTriggered_ && channel_->isWriteEvent())
+    {
+        return; // 发送缓冲区满了，在等EPOLLOUT，handleWrite会接着发
+    }
+
+    int savedErrno = 0;
+    ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+    if(n >= 0)
+    {
+        increment(bytesSent_, n);
+        outputBuffer_.retrieve(n);
+    }
+    else if(savedErrno != EWOULDBLOCK)
+    {
+        LOG_ERROR("TcpConnection::flushInLoop");
+        if(savedErrno == EPIPE || savedErrno == ECONNRESET)
+        {
+            outputBuffer_.retrieveAll();
+            return;
+        }
+        if(savedErrno == EIO)
+        {
+            abortWrite();
+            return;
+        }
+    }
+    updateBufferStats();
+
+    if(outputBuffer_.readableBytes() > 0)
+    {
         if(!channel_->isWriteEvent())
         {
-            channel_->enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+            channel_->enableWriting();
         }
+        return;
+    }
+    if(writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if(state_ == kDisconnecting)
+    {
+        shutdownInLoop();
     }
 }
 
@@ -148,6 +449,12 @@ void TcpConnection::connectEstablished()
      * TcpConnection中的回调方法，tie就是channel判断，TcpConnection是否还存在，没有被用户remove
     */
     channel_->tie(shared_from_this());
+    if(edgeTriggered_)
+    {
+        // ET模式下读写事件一次性注册好，之后不再修改
+        channel_->setEdgeTriggered(true);
+        channel_->enableWriting();
+    }
     channel_->enableReading(); // 向poller注册channel的epollin事件
 
     // 新连接建立，执行回调
@@ -157,13 +464,15 @@ void TcpConnection::connectEstablished()
 // 连接销毁
 void TcpConnection::connectDestroyed()
 {
-    if(state_ = kConnected)
+    if(state_ == kConnected)
     {
         setState(kDisconnected);
         channel_->disableAll(); // 把channel的所有感兴趣的事件从poller中del掉
         connectionCallback_(shared_from_this());
     }
+    detachRelay(); // TcpServer析构的时候不经过handleClose
     channel_->remove(); // 把channel从poller中删除掉
+    loop_->connectionRemoved();
 }
 
 // 关闭连接
@@ -173,27 +482,110 @@ void TcpConnection::shutdown()
     {
         setState(kDisconnecting);
         loop_->runInLoop(
-            std::bind(&TcpConnection::shutdownInLoop, this);
+            std::bind(&TcpConnection::shutdownInLoop, this)
         );
     }
 }
 
 void TcpConnection::shutdownInLoop()
 {
-    if(!channel_->isWriteEvent()) // 说明outputBuffer中的数据已经全部发送成功
+    if(!isWriting()) // 说明outputBuffer中的数据已经全部发送成功
     {
         socket_->shutdownWrite(); // 关闭写端
     }
 }
 
+void TcpConnection::forceClose()
+{
+    if(state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this())
+        );
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if(state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+// outputBuffer_中的文件区间被截断了(writeFd返回EIO)  后面的数据不能再发，否则对端收到的字节流中间缺一段，只能断开
+void TcpConnection::abortWrite()
+{
+    LOG_ERROR("TcpConnection::abortWrite[%s] - %lu bytes unsent \n", name_.c_str(), outputBuffer_.readableBytes());
+    outputBuffer_.retrieveAll();
+    updateBufferStats();
+    forceClose();
+}
+
+void TcpConnection::detachRelay()
+{
+    if(relay_)
+    {
+        std::shared_ptr<TcpRelay> relay;
+        relay.swap(relay_); // 断开 TcpConnection <=> TcpRelay 的循环引用
+        relay->handleClose(this);
+    }
+}
+
+void TcpConnection::updateBufferStats()
+{
+    inputBufferBytes_.store(inputBuffer_.readableBytes(), std::memory_order_relaxed);
+    outputBufferBytes_.store(outputBuffer_.readableBytes(), std::memory_order_relaxed);
+}
+
+void TcpConnection::stats(Stats *s) const
+{
+    s->name = name_;
+    s->peer = peerAddr_.toIpPort();
+    s->ageUs = Timestamp::nowCoarse() - createTime_;
+    s->bytesReceived = bytesReceived();
+    s->bytesSent = bytesSent();
+    s->messagesReceived = messagesReceived();
+    s->messagesSent = messagesSent();
+    s->highWaterMarkHits = highWaterMarkHits();
+    s->inputBufferBytes = inputBufferBytes_.load(std::memory_order_relaxed);
+    s->outputBufferBytes = outputBufferBytes_.load(std::memory_order_relaxed);
+}
+
+bool TcpConnection::isWriting() const
+{
+    if(edgeTriggered_)
+    {
+        return outputBuffer_.readableBytes() > 0;
+    }
+    // cork模式下攒着还没发的数据也算，shutdownInLoop要等flushInLoop发完再关闭写端
+    return channel_->isWriteEvent() || (cork_ && outputBuffer_.readableBytes() > 0);
+}
+
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if(relay_)
+    {
+        relay_->handleRead(this);
+        return;
+    }
+    if(edgeTriggered_)
+    {
+        handleReadEdgeTriggered(receiveTime);
+        return;
+    }
+
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    // 超出读预算的数据留在socket里，LT模式下一轮poll还会通知
+    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno, loop_->readBudget());
     if(n > 0)
     {
+        increment(bytesReceived_, n);
+        increment(messagesReceived_, 1);
         // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作onMessage
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        updateBufferStats(); // onMessage里的send也在这里一起记下
     }
     else if(n == 0)
     {
@@ -207,15 +599,89 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
+// ET模式  一直读到EAGAIN，读到的数据一次性交给onMessage
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime)
+{
+    ssize_t total = 0;
+    bool peerClosed = false;
+    bool drained = false;
+    int savedErrno = 0;
+    size_t budget = loop_->readBudget();
+    if(budget == 0)
+    {
+        budget = KDefaultEdgeReadBudget;
+    }
+    for(int i = 0;i < KMaxReadsPerEvent;i++)
+    {
+        if(static_cast<size_t>(total) >= budget) // 读预算用完了
+        {
+            break;
+        }
+        ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno, budget - total);
+        if(n > 0)
+        {
+            total += n;
+        }
+        else if(n == 0)
+        {
+            peerClosed = true;
+            break;
+        }
+        else
+        {
+            if(savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+            {
+                errno = savedErrno;
+                LOG_ERROR("TcpConnection::handleRead");
+                handleError();
+            }
+            drained = true;
+            break;
+        }
+    }
+
+    if(total > 0)
+    {
+        increment(bytesReceived_, total);
+        increment(messagesReceived_, 1);
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        updateBufferStats();
+    }
+
+    if(peerClosed)
+    {
+        handleClose();
+    }
+    else if(!drained && state_ != kDisconnected)
+    {
+        // 读的次数或者读预算用完了，socket里可能还有数据，但是ET不会再通知了
+        // 放到loop这一轮的最后接着读，先让同一个loop上的其它连接处理完这一轮的事件
+        loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+    }
+}
+
 void TcpConnection::handleWrite()
 {
-    if(channel_->isWriteEvent)
+    if(relay_)
+    {
+        relay_->handleWrite(this);
+        return;
+    }
+    if(edgeTriggered_)
+    {
+        handleWriteEdgeTriggered();
+        return;
+    }
+
+    if(channel_->isWriteEvent())
     {
         int savedErrno = 0;
         ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
         if(n > 0)
         {
+            increment(bytesSent_, n);
             outputBuffer_.retrieve(n);
+            updateBufferStats();
             if(outputBuffer_.readableBytes() == 0) // 说明所有数据都已经写到了fd中
             {
                 channel_->disableWriting();
@@ -235,6 +701,10 @@ void TcpConnection::handleWrite()
         else
         {
             LOG_ERROR("TcpConnection::handleWrite");
+            if(savedErrno == EIO)
+            {
+                abortWrite();
+            }
         }
     }
     else
@@ -243,10 +713,57 @@ void TcpConnection::handleWrite()
     }
 }
 
+// ET模式  EPOLLOUT一直注册着，缓冲区为空时的EPOLLOUT直接忽略，不用disableWriting
+void TcpConnection::handleWriteEdgeTriggered()
+{
+    if(state_ == kDisconnected || outputBuffer_.readableBytes() == 0)
+    {
+        return;
+    }
+
+    while(outputBuffer_.readableBytes() > 0)
+    {
+        int savedErrno = 0;
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        if(n >= 0)
+        {
+            increment(bytesSent_, n);
+            outputBuffer_.retrieve(n);
+        }
+        else
+        {
+            if(savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+            {
+                LOG_ERROR("TcpConnection::handleWrite");
+                if(savedErrno == EIO)
+                {
+                    abortWrite();
+                    return;
+                }
+            }
+            updateBufferStats();
+            return; // 发送缓冲区满了，等下一次EPOLLOUT
+        }
+    }
+    updateBufferStats();
+
+    if(writeCompleteCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this())
+        );
+    }
+    if(state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
 // poller => channel::closeCallback => TcpConnection::handleClose
 void TcpConnection::handleClose()
 {
     LOG_INFO("fd=%d state=%d", channel_->fd(), (int)state_);
+    detachRelay();
     setState(kDisconnected);
     channel_->disableAll();
 
@@ -255,8 +772,56 @@ void TcpConnection::handleClose()
     closeCallback_(connPtr); // 关闭连接的回调, z执行的是TcpServer::removeConnection的回调方法
 }
 
+void TcpConnection::setZeroCopy(size_t threshold)
+{
+    if(threshold > 0 && !zeroCopy_)
+    {
+        if(!socket_->setZeroCopy(true))
+        {
+            return; // 内核不支持，还是普通的拷贝发送
+        }
+        zeroCopy_ = true;
+    }
+    outputBuffer_.setZeroCopyThreshold(threshold);
+}
+
+void TcpConnection::handleZeroCopyCompletions()
+{
+    while(true)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if(::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            return; // EAGAIN 错误队列已经读空了
+        }
+        for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);cmsg != nullptr;cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+            struct sock_extended_err *serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if(serr->ee_errno == 0 && serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+            {
+                outputBuffer_.zeroCopyCompleted(serr->ee_info, serr->ee_data,
+                    (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+            }
+        }
+    }
+}
+
 void TcpConnection::handleError()
 {
+    if(zeroCopy_)
+    {
+        // MSG_ZEROCOPY的完成通知也是通过EPOLLERR报告的，必须读空错误队列，否则LT模式下会一直触发
+        handleZeroCopyCompletions();
+    }
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
@@ -268,6 +833,10 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
+    if(zeroCopy_ && err == 0) // 只是零拷贝的完成通知
+    {
+        return;
+    }
 
-    LOG_INFO("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name.c_str(), err);
+    LOG_INFO("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
 }
\ No newline at end of file
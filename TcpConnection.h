@@ -4,6 +4,8 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "Slice.h"
 #include "Timestamp.h"
 
 #include <memory>
@@ -13,6 +15,7 @@
 class Channel;
 class EventLoop;
 class Socket;
+class TcpRelay;
 
 /**
  * TcpServer => Acceptor => 有一个新用户连接,通过accept函数拿到connfd
@@ -22,7 +25,7 @@ class Socket;
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
-    TcpConnection(EventLoop *loop
+    TcpConnection(EventLoop *loop,
                 const std::string &name,
                 int sockfd,
                 const InetAddress &localAddr,
@@ -36,10 +39,84 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
-    // 发送数据
-    void send(std::string &buf);
+    /**
+     * 连接的计数  只有loop线程更新(relaxed原子变量，没有lock前缀)，任何线程都可以随时读
+     * 缓冲区大小是每次读写事件处理完之后记下来的，不是实时的
+     * 用splice转发(TcpRelay)的数据不经过缓冲区，不计入收发字节数
+    */
+    struct Stats
+    {
+        std::string name;
+        std::string peer;
+        int64_t ageUs = 0; // 连接建立到现在的时间
+        uint64_t bytesReceived = 0;
+        uint64_t bytesSent = 0;
+        uint64_t messagesReceived = 0; // messageCallback的次数
+        uint64_t messagesSent = 0; // send的次数
+        uint64_t highWaterMarkHits = 0; // outputBuffer_超过高水位的次数
+        size_t inputBufferBytes = 0;
+        size_t outputBufferBytes = 0;
+    };
+    void stats(Stats *s) const;
+    uint64_t bytesReceived() const { return bytesReceived_.load(std::memory_order_relaxed); }
+    uint64_t bytesSent() const { return bytesSent_.load(std::memory_order_relaxed); }
+    uint64_t messagesReceived() const { return messagesReceived_.load(std::memory_order_relaxed); }
+    uint64_t messagesSent() const { return messagesSent_.load(std::memory_order_relaxed); }
+    uint64_t highWaterMarkHits() const { return highWaterMarkHits_.load(std::memory_order_relaxed); }
+
+    /**
+     * 边缘触发模式  需要在connectEstablished之前设置
+     * handleRead一直读到EAGAIN(每次事件最多读KMaxReadsPerEvent次、读预算这么多字节，防止一个连接饿死同一个loop上的其它连接)
+     * EPOLLOUT在整个连接的生命周期内一直注册着，不再随着outputBuffer_的空/非空反复epoll_ctl
+    */
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
+    /**
+     * cork模式  loop这一轮里send的数据先攒在outputBuffer_中，等这一轮的活跃channel都处理完之后一次writev发出去
+     * 流水线请求一次onMessage回复多个响应(或者一个响应分header/body多次send)的时候，write系统调用从每次send一次变成每轮一次
+     * 需要在loop线程里调用，比如在connectionCallback里  关闭的时候马上发送攒下的数据
+    */
+    void setCork(bool on);
+    bool isCorked() const { return cork_; }
+    // 马上发送cork模式下攒着的数据，不等到这一轮结束  延迟敏感的响应send之后调用  可以跨线程调用
+    void flush();
+    // 关闭Nagle算法  不开cork的时候一个响应分多次send，后面的小包会被Nagle拖到对端的delayed ack之后
+    void setTcpNoDelay(bool on);
+
+    /**
+     * 发送数据  可以跨线程调用
+     * const std::string&: 在loop线程里直接发送；其它线程调用的时候拷贝一份交给loop线程
+     * std::string&&: 接管buf的内存，跨线程不拷贝
+     * Buffer*: 发送buf中所有可读的数据，接管buf的内存，调用之后buf为空
+     * Slice: 引用计数的只读数据，跨线程只增加引用计数，同一个Slice可以发给很多连接
+    */
+    void send(const std::string &buf);
+    void send(std::string &&buf);
+    void send(Buffer *buf);
+    void send(const Slice &slice);
+    /**
+     * 发送buf中的所有数据，buf中的内存段直接移动到outputBuffer_，不拷贝，调用之后buf为空
+     * header + body + trailer可以先分别append/appendSlice到一个ChainBuffer里，再一次writev发出去
+    */
+    void send(ChainBuffer *buf);
+    /**
+     * 用sendfile发送文件fd的[offset, offset+length)，数据不经过用户态
+     * 内部dup了fd，调用之后就可以close(fd)；和之前send的数据按顺序发送，计入高水位，全部发完回调writeCompleteCallback
+     * 发送的时候文件比length短(被截断了)，后面的数据不再发送，直接断开连接
+    */
+    void sendFile(int fd, off_t offset, size_t length);
+
+    /**
+     * 零拷贝发送  send(ChainBuffer*)里不小于threshold字节的外部内存片(appendSlice)用MSG_ZEROCOPY发送
+     * 内存片的owner保留到内核的完成通知(socket错误队列，在handleError里读取)为止  threshold = 0 关闭
+     * 需要在loop线程里调用，比如在connectionCallback里
+    */
+    void setZeroCopy(size_t threshold);
     // 关闭连接
     void shutdown();
+    // 不等outputBuffer_发完，直接关闭连接  可以跨线程调用
+    void forceClose();
 
     void setConnectionCallback(const ConnectionCallback& cb)
     {
@@ -53,9 +130,14 @@ public:
     {
         writeCompleteCallback_ = cb;
     }
-    void setHighWaterMarkCallback(const HighWaterMarkCallback& cb)
+    void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
+        highWaterMark_ = highWaterMark;
+    }
+    void setCloseCallback(const CloseCallback& cb)
     {
-        highWaterMark_ = cb;
+        closeCallback_ = cb;
     }
 
     // 连接建立
@@ -63,22 +145,57 @@ public:
     // 连接销毁
     void connectDestroyed();
 private:
+    friend class TcpRelay;
+
+    static const int KMaxReadsPerEvent = 16;
+    // ET模式下loop没有设置读预算时每次可读事件最多读的字节数  只限制次数的话一个大流量的连接一次能读走几MB
+    static const size_t KDefaultEdgeReadBudget = Buffer::KMaxReadSizeHint;
+
     enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
     void setState(StateE state) { state_ = state; }
 
     void handleRead(Timestamp receiveTime);
     void handleWrite();
+    void handleReadEdgeTriggered(Timestamp receiveTime);
+    void handleWriteEdgeTriggered();
     void handleClose();
     void handleError();
+    // 读取socket错误队列里的MSG_ZEROCOPY完成通知
+    void handleZeroCopyCompletions();
 
     void sendInLoop(const void* message, size_t len);
+    void sendChainInLoop(ChainBuffer *buf);
+    void sendSliceInLoop(const Slice &slice);
+    void sendChainPtrInLoop(const std::shared_ptr<ChainBuffer> &buf) { sendChainInLoop(buf.get()); }
+    void sendFileInLoop(int fd, off_t offset, size_t length);
+    // cork模式下，这一轮第一次有数据攒进outputBuffer_的时候，登记一个flushInLoop到这一轮的最后执行
+    void scheduleFlush();
+    void flushInLoop();
+    // outputBuffer_中是否还有数据在等待EPOLLOUT(或者cork模式下等这一轮结束)
+    bool isWriting() const;
 
     void shutdownInLoop();
+    void forceCloseInLoop();
+    // writeFd报EIO(文件区间被截断)  丢掉剩下的数据，断开连接
+    void abortWrite();
+    // 连接关闭，通知relay_拆掉这一边的转发
+    void detachRelay();
+    // 只有loop线程写，不需要fetch_add的lock前缀
+    static void increment(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    // 记下当前的缓冲区大小，给其它线程的stats读
+    void updateBufferStats();
 
     EventLoop *loop_; // 这里绝对不是baseLoop, 因为TcpConnection都是在subLoop管理的
     const std::string name_;
     std::atomic_int state_;
     bool reading_;
+    bool edgeTriggered_;
+    bool zeroCopy_; // socket上已经设置了SO_ZEROCOPY
+    bool cork_;
+    bool flushPending_; // 已经queueInLoop了flushInLoop，还没有执行
 
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<Channel> channel_;
@@ -94,5 +211,16 @@ private:
     size_t highWaterMark_;
 
     Buffer inputBuffer_; // 接收数据的缓冲区
-    Buffer outputBuffer_; // 发送数据的缓冲区
+    ChainBuffer outputBuffer_; // 发送数据的缓冲区  链式的，writev发送
+
+    std::shared_ptr<TcpRelay> relay_; // 不为空的时候读写事件都交给relay_，用splice转发
+
+    const Timestamp createTime_;
+    std::atomic<uint64_t> bytesReceived_;
+    std::atomic<uint64_t> bytesSent_;
+    std::atomic<uint64_t> messagesReceived_;
+    std::atomic<uint64_t> messagesSent_;
+    std::atomic<uint64_t> highWaterMarkHits_;
+    std::atomic<size_t> inputBufferBytes_;
+    std::atomic<size_t> outputBufferBytes_;
 };
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include "TcpRelay.h"
+#include "TcpConnection.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Socket.h"
+#include "Logger.h"
+
+#include <functional>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+const size_t TcpRelay::KPipeSize;
+const size_t TcpRelay::KSpliceSize;
+
+static const unsigned int KSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+// splice两端都可能返回EAGAIN，用poll区分到底是pipe那一端还是socket那一端没准备好
+static bool pollOnce(int fd, short events)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, 0) > 0 && (pfd.revents & events);
+}
+
+TcpRelay::TcpRelay(const TcpConnectionPtr &a, const TcpConnectionPtr &b)
+    : finished_(0)
+    , closing_(false)
+    , ok_(true)
+{
+    directions_[0].src = a;
+    directions_[0].dst = b;
+    directions_[1].src = b;
+    directions_[1].dst = a;
+    for(Direction &dir : directions_)
+    {
+        dir.bytes = 0;
+        int fds[2];
+        if(::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            LOG_ERROR("TcpRelay pipe2 errno:%d \n", errno);
+            dir.pipeReadFd = dir.pipeWriteFd = -1;
+            ok_ = false;
+            continue;
+        }
+        ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(KPipeSize)); // 失败的话就用默认的64KB
+        dir.pipeReadFd = fds[0];
+        dir.pipeWriteFd = fds[1];
+    }
+}
+
+TcpRelay::~TcpRelay()
+{
+    // 对应的Channel已经在各自的loop里从poller中删除了(closePipeRead/closePipeWrite)
+    for(Direction &dir : directions_)
+    {
+        if(dir.pipeReadFd >= 0)
+        {
+            ::close(dir.pipeReadFd);
+        }
+        if(dir.pipeWriteFd >= 0)
+        {
+            ::close(dir.pipeWriteFd);
+        }
+    }
+}
+
+void TcpRelay::start()
+{
+    TcpConnectionPtr a = directions_[0].src;
+    TcpConnectionPtr b = directions_[0].dst;
+    if(!ok_ || a->isEdgeTriggered() || b->isEdgeTriggered())
+    {
+        LOG_ERROR("TcpRelay::start %s <=> %s failed, pipe error or edge triggered connection \n",
+            a->name().c_str(), b->name().c_str());
+        closeConnections();
+        return;
+    }
+    // 用queueInLoop，在调用者(比如onMessage)返回之后再接管连接
+    a->getLoop()->queueInLoop(std::bind(&TcpRelay::attach, shared_from_this(), a));
+    b->getLoop()->queueInLoop(std::bind(&TcpRelay::attach, shared_from_this(), b));
+}
+
+void TcpRelay::attach(const TcpConnectionPtr &conn)
+{
+    if(!conn->connected() || closing_)
+    {
+        closeConnections();
+        return;
+    }
+    EventLoop *loop = conn->getLoop();
+    conn->relay_ = shared_from_this();
+
+    int out = directionOfSrc(conn.get());
+    Direction &outDir = directions_[out];
+    outDir.pipeWriteChannel.reset(new Channel(loop, outDir.pipeWriteFd));
+    outDir.pipeWriteChannel->setWriteCallback(std::bind(&TcpRelay::fillPipe, this, out));
+    outDir.pipeWriteChannel->tie(shared_from_this());
+
+    int in = directionOfDst(conn.get());
+    Direction &inDir = directions_[in];
+    inDir.pipeReadChannel.reset(new Channel(loop, inDir.pipeReadFd));
+    inDir.pipeReadChannel->setReadCallback(std::bind(&TcpRelay::flushPipe, this, in));
+    inDir.pipeReadChannel->setCloseCallback(std::bind(&TcpRelay::flushPipe, this, in)); // 写端关闭并且读空的时候只有EPOLLHUP
+    inDir.pipeReadChannel->tie(shared_from_this());
+    inDir.pipeReadChannel->enableReading();
+
+    // inputBuffer_中已经读上来的数据先写进pipe，然后开始splice
+    fillPipe(out);
+    // relay之前send的数据还在outputBuffer_中的，先发出去
+    flushPipe(in);
+}
+
+void TcpRelay::fillPipe(int d)
+{
+    Direction &dir = directions_[d];
+    TcpConnection *src = dir.src.get();
+    if(dir.pipeWriteFd < 0 || !dir.pipeWriteChannel)
+    {
+        return;
+    }
+
+    Buffer &pending = src->inputBuffer_;
+    if(pending.readableBytes() > 0)
+    {
+        ssize_t n = ::write(dir.pipeWriteFd, pending.peek(), pending.readableBytes());
+        if(n > 0)
+        {
+            pending.retrieve(n);
+            dir.bytes += n;
+        }
+        else if(errno != EAGAIN)
+        {
+            LOG_ERROR("TcpRelay::fillPipe write pipe errno:%d \n", errno);
+            closeConnections();
+            return;
+        }
+        if(pending.readableBytes() > 0)
+        {
+            waitPipeWritable(d);
+            return;
+        }
+    }
+
+    int srcFd = src->channel_->fd();
+    size_t budget = src->loop_->readBudget();
+    size_t total = 0;
+    for(int i = 0;i < KMaxSplicesPerEvent;i++)
+    {
+        if(budget > 0 && total >= budget) // 读预算用完了，LT模式下一轮poll还会通知
+        {
+            return;
+        }
+        ssize_t n = ::splice(srcFd, NULL, dir.pipeWriteFd, NULL, KSpliceSize, KSpliceFlags);
+        if(n > 0)
+        {
+            dir.bytes += n;
+            total += n;
+        }
+        else if(n == 0)
+        {
+            // src半关闭  关闭pipe写端，dst读完pipe里剩下的数据之后会读到EOF
+            src->channel_->disableReading();
+            closePipeWrite(d);
+            return;
+        }
+        else if(errno == EAGAIN)
+        {
+            if(pollOnce(dir.pipeWriteFd, POLLOUT))
+            {
+                // socket读空了，等src的下一次可读
+                if(!src->channel_->isReadEvent())
+                {
+                    src->channel_->enableReading();
+                }
+                if(dir.pipeWriteChannel->isWriteEvent())
+                {
+                    dir.pipeWriteChannel->disableWriting();
+                }
+            }
+            else
+            {
+                waitPipeWritable(d);
+            }
+            return;
+        }
+        else
+        {
+            LOG_ERROR("TcpRelay::fillPipe splice from fd=%d errno:%d \n", srcFd, errno);
+            closeConnections();
+            return;
+        }
+    }
+}
+
+void TcpRelay::flushPipe(int d)
+{
+    Direction &dir = directions_[d];
+    TcpConnection *dst = dir.dst.get();
+    if(dir.pipeReadFd < 0 || !dir.pipeReadChannel)
+    {
+        return;
+    }
+
+    int dstFd = dst->channel_->fd();
+    ChainBuffer &pending = dst->outputBuffer_;
+    if(pending.readableBytes() > 0)
+    {
+        int savedErrno = 0;
+        ssize_t n = pending.writeFd(dstFd, &savedErrno);
+        if(n >= 0)
+        {
+            pending.retrieve(n);
+        }
+        else if(savedErrno != EAGAIN)
+        {
+            LOG_ERROR("TcpRelay::flushPipe write fd=%d errno:%d \n", dstFd, savedErrno);
+            closeConnections();
+            return;
+        }
+        if(pending.readableBytes() > 0)
+        {
+            waitDstWritable(d);
+            return;
+        }
+    }
+
+    for(int i = 0;i < KMaxSplicesPerEvent;i++)
+    {
+        ssize_t n = ::splice(dir.pipeReadFd, NULL, dstFd, NULL, KSpliceSize, KSpliceFlags);
+        if(n > 0)
+        {
+            continue;
+        }
+        else if(n == 0)
+        {
+            // pipe读空了并且写端已经关闭  把src的半关闭传给dst
+            if(dst->channel_->isWriteEvent())
+            {
+                dst->channel_->disableWriting();
+            }
+            closePipeRead(d);
+            dst->socket_->shutdownWrite();
+            if(++finished_ == 2)
+            {
+                closeConnections();
+            }
+            return;
+        }
+        else if(errno == EAGAIN)
+        {
+            if(pollOnce(dir.pipeReadFd, POLLIN))
+            {
+                waitDstWritable(d);
+            }
+            else
+            {
+                // pipe空了，等src那边写进来
+                if(dst->channel_->isWriteEvent())
+                {
+                    dst->channel_->disableWriting();
+                }
+                if(!dir.pipeReadChannel->isReadEvent())
+                {
+                    dir.pipeReadChannel->enableReading();
+                }
+            }
+            return;
+        }
+        else
+        {
+            LOG_ERROR("TcpRelay::flushPipe splice to fd=%d errno:%d \n", dstFd, errno);
+            closeConnections();
+            return;
+        }
+    }
+}
+
+void TcpRelay::waitPipeWritable(int d)
+{
+    Direction &dir = directions_[d];
+    Channel *srcChannel = dir.src->channel_.get();
+    if(srcChannel->isReadEvent())
+    {
+        srcChannel->disableReading();
+    }
+    if(!dir.pipeWriteChannel->isWriteEvent())
+    {
+        dir.pipeWriteChannel->enableWriting();
+    }
+}
+
+void TcpRelay::waitDstWritable(int d)
+{
+    Direction &dir = directions_[d];
+    if(dir.pipeReadChannel->isReadEvent())
+    {
+        dir.pipeReadChannel->disableReading();
+    }
+    Channel *dstChannel = dir.dst->channel_.get();
+    if(!dstChannel->isWriteEvent())
+    {
+        dstChannel->enableWriting();
+    }
+}
+
+// Channel对象留到TcpRelay析构，这里可能正在它自己的handleEvent里
+void TcpRelay::closePipeWrite(int d)
+{
+    Direction &dir = directions_[d];
+    if(dir.pipeWriteFd < 0)
+    {
+        return;
+    }
+    // 先从poller中删除再close，close之后fd可能马上被别的连接复用
+    if(dir.pipeWriteChannel)
+    {
+        if(!dir.pipeWriteChannel->isNoneEvent())
+        {
+            dir.pipeWriteChannel->disableAll();
+        }
+        dir.pipeWriteChannel->remove();
+    }
+    ::close(dir.pipeWriteFd);
+    dir.pipeWriteFd = -1;
+}
+
+void TcpRelay::closePipeRead(int d)
+{
+    Direction &dir = directions_[d];
+    if(dir.pipeReadFd < 0)
+    {
+        return;
+    }
+    // 先从poller中删除再close，close之后fd可能马上被别的连接复用
+    if(dir.pipeReadChannel)
+    {
+        if(!dir.pipeReadChannel->isNoneEvent())
+        {
+            dir.pipeReadChannel->disableAll();
+        }
+        dir.pipeReadChannel->remove();
+    }
+    ::close(dir.pipeReadFd);
+    dir.pipeReadFd = -1;
+}
+
+void TcpRelay::handleClose(TcpConnection *conn)
+{
+    closePipeWrite(directionOfSrc(conn));
+    closePipeRead(directionOfDst(conn));
+    closeConnections();
+}
+
+void TcpRelay::closeConnections()
+{
+    if(closing_.exchange(true))
+    {
+        return;
+    }
+    directions_[0].src->forceClose();
+    directions_[0].dst->forceClose();
+}
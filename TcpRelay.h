@@ -0,0 +1,85 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+class Channel;
+class TcpConnection;
+
+/**
+ * 两个TcpConnection之间的双向转发(L4代理/隧道)  两个连接可以在不同的subloop上
+ * 每个方向一个pipe：src socket =splice=> pipe =splice=> dst socket，数据不经过用户态，也不进inputBuffer_/outputBuffer_
+ *
+ * 每个fd只在它自己的loop线程里操作，pipe就是两个loop之间的队列：
+ * src的loop: src socket的读事件 + pipe写端的EPOLLOUT   dst的loop: pipe读端的EPOLLIN + dst socket的EPOLLOUT
+ * 背压: pipe满了停止读src，等pipe可写；dst的发送缓冲区满了停止读pipe，等dst可写
+ * 半关闭: src读到EOF之后关闭pipe写端，dst把pipe读空之后shutdownWrite；两个方向都结束之后关闭两个连接
+ * 任意一个连接出错或者被关闭，另一个连接也会被关闭
+ *
+ * 用法: std::shared_ptr<TcpRelay> relay(new TcpRelay(a, b)); relay->start();
+ * start之后两个连接不再回调messageCallback，也不能再send；inputBuffer_中还没处理的数据会先转发出去
+ * 只支持LT模式的连接
+*/
+class TcpRelay : noncopyable, public std::enable_shared_from_this<TcpRelay>
+{
+public:
+    static const size_t KPipeSize = 1024 * 1024; // 每个方向的pipe容量(F_SETPIPE_SZ，受/proc/sys/fs/pipe-max-size限制)
+    static const size_t KSpliceSize = 64 * 1024; // 一次splice最多移动的字节数
+    static const int KMaxSplicesPerEvent = 16;
+
+    TcpRelay(const TcpConnectionPtr &a, const TcpConnectionPtr &b);
+    ~TcpRelay();
+
+    // 开始转发  可以跨线程调用
+    void start();
+
+    // a=>b 和 b=>a 已经转发的字节数
+    int64_t bytesAtoB() const { return directions_[0].bytes; }
+    int64_t bytesBtoA() const { return directions_[1].bytes; }
+private:
+    // 一个方向的转发
+    struct Direction
+    {
+        TcpConnectionPtr src;
+        TcpConnectionPtr dst;
+        int pipeReadFd;
+        int pipeWriteFd;
+        std::unique_ptr<Channel> pipeReadChannel; // 在dst的loop里
+        std::unique_ptr<Channel> pipeWriteChannel; // 在src的loop里
+        std::atomic<int64_t> bytes;
+    };
+
+    friend class TcpConnection;
+    // 下面三个由TcpConnection在自己的loop线程里调用
+    void handleRead(TcpConnection *conn) { fillPipe(directionOfSrc(conn)); }
+    void handleWrite(TcpConnection *conn) { flushPipe(directionOfDst(conn)); }
+    // conn被关闭了，拆掉conn这一边的pipe，并且关闭另一个连接
+    void handleClose(TcpConnection *conn);
+
+    int directionOfSrc(TcpConnection *conn) const { return directions_[0].src.get() == conn ? 0 : 1; }
+    int directionOfDst(TcpConnection *conn) const { return directions_[0].dst.get() == conn ? 0 : 1; }
+
+    // 在conn的loop里接管conn的读写事件
+    void attach(const TcpConnectionPtr &conn);
+    // src socket => pipe   src可读或者pipe可写的时候调用
+    void fillPipe(int d);
+    // pipe => dst socket   pipe可读或者dst可写的时候调用
+    void flushPipe(int d);
+    // 停止读src，等pipe可写
+    void waitPipeWritable(int d);
+    // 停止读pipe，等dst可写
+    void waitDstWritable(int d);
+    void closePipeWrite(int d);
+    void closePipeRead(int d);
+    // 关闭两个连接  可以跨线程调用，只执行一次
+    void closeConnections();
+
+    Direction directions_[2]; // 0: a=>b 1: b=>a
+    std::atomic_int finished_; // 已经完成半关闭的方向数
+    std::atomic_bool closing_;
+    bool ok_; // pipe创建成功
+};
@@ -5,6 +5,8 @@
 #include "EventLoop.h"
 
 #include <strings.h>
+#include <future>
+#include <algorithm>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
 {
@@ -16,27 +18,90 @@ static EventLoop* CheckLoopNotNull(EventLoop* loop)
     return loop;
 }
 
-TcpServer::TcpServer(EventLoop* loop
+TcpServer::TcpServer(EventLoop* loop,
             const InetAddress& listenAddr,
-            const string& nameArg,
+            const std::string& nameArg,
             Option option)
             : loop_(loop)
+            , listenAddr_(listenAddr)
             , ipPort_(listenAddr.toIpPort())
             , name_(nameArg)
-            , acceptor_(new Acceptor(loop, listenAddr, option == KReusePort))
+            , option_(option)
+            , acceptor_(option == KReusePortSharded ? nullptr : new Acceptor(loop, listenAddr, option == KReusePort))
+            , cpuSteering_(false)
             , threadPool_(new EventLoopThreadPool(loop, name_))
             , connectionCallback_()
             , messageCallback_()
             , nextConnId_(1)
             , started_(0)
+            , edgeTriggered_(false)
+            , cork_(false)
+            , maxAcceptsPerEvent_(Acceptor::KMaxAcceptsPerEvent)
+            , readBudget_(0)
             {
                 // 当有新用户连接时，会执行TcpServer::newConnection
-                acceptor_.setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-                    std::placeholders::_1, std::placeholders::_2));
+                if(acceptor_)
+                {
+                    acceptor_->setNewConnectionsCallback(std::bind(&TcpServer::newConnections, this,
+                        std::placeholders::_1));
+                }
             }
     
+/**
+ * KReusePortSharded模式下一个接一个地listen  第i个loop listen完了再把第i+1个交给它的loop
+ * acceptors[i]只在loops[i]线程里访问，TcpServer析构的时候也是在loops[i]线程里置空，还在路上的listen看到空指针就停下
+*/
+struct TcpServer::ShardListen
+{
+    std::vector<EventLoop*> loops;
+    std::vector<Acceptor*> acceptors;
+    bool cpuSteering;
+};
+
+void TcpServer::listenShard(const std::shared_ptr<ShardListen> &state, size_t i)
+{
+    Acceptor *acceptor = state->acceptors[i];
+    if(acceptor == nullptr)
+    {
+        return; // TcpServer已经析构了
+    }
+    acceptor->listen();
+    if(i + 1 < state->loops.size())
+    {
+        state->loops[i + 1]->runInLoop(std::bind(&TcpServer::listenShard, state, i + 1));
+    }
+    else if(state->cpuSteering)
+    {
+        // 整个reuseport组都listen了  CBPF程序挂在组里任意一个socket上，对整个组生效
+        int numShards = static_cast<int>(state->loops.size());
+        state->loops[0]->runInLoop([state, numShards]() {
+            if(state->acceptors[0] != nullptr)
+            {
+                state->acceptors[0]->setReusePortCpuSteering(numShards);
+            }
+        });
+    }
+}
+
 TcpServer::~TcpServer()
 {
+    // 每个subloop的acceptor要在它自己的loop线程里销毁(从poller中删除channel)
+    // 必须等销毁完成再往下走，否则subloop还可能在已经析构的TcpServer上调用newShardConnection
+    for(size_t i = 0;i < shardAcceptors_.size();i++)
+    {
+        Acceptor *ptr = shardAcceptors_[i].release();
+        std::shared_ptr<ShardListen> state = shardListen_;
+        std::promise<void> destroyed;
+        ptr->getLoop()->runInLoop([ptr, state, i, &destroyed]() {
+            state->acceptors[i] = nullptr;
+            delete ptr;
+            destroyed.set_value();
+        });
+        destroyed.get_future().wait();
+    }
+    shardAcceptors_.clear();
+
+    std::unique_lock<std::mutex> lock(connectionsMutex_);
     for(auto &item : connections_)
     {
         TcpConnectionPtr conn(item.second); // 这个局部的shared_ptr对象，出右括号，可以自动释放new出来的TcpConnection对象资源
@@ -55,24 +120,145 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setBusyPoll(int numLoops, int spinUs)
+{
+    threadPool_->setBusyPoll(numLoops, spinUs);
+}
+
+void TcpServer::setLoadBalance(EventLoopThreadPool::LoadBalance strategy)
+{
+    threadPool_->setLoadBalance(strategy);
+}
+
+void TcpServer::setCpuAffinity(const std::vector<int> &cpus)
+{
+    threadPool_->setCpuAffinity(cpus);
+}
+
+void TcpServer::setNumaSpread(bool on)
+{
+    threadPool_->setNumaSpread(on);
+}
+
+void TcpServer::setMaxAcceptsPerEvent(int n)
+{
+    maxAcceptsPerEvent_ = n;
+    if(acceptor_)
+    {
+        acceptor_->setMaxAcceptsPerEvent(n);
+    }
+}
+
+void TcpServer::setEdgeTriggered(bool on)
+{
+    edgeTriggered_ = on;
+    if(acceptor_)
+    {
+        acceptor_->setEdgeTriggered(on);
+    }
+}
+
 // 开启服务器监听
 void TcpServer::start()
 {
     if(started_++ == 0) // 防止一个TcpServer对象被start多次
     {
         threadPool_->start(threadInitCallback_); // 启动底层的线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        for(EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            ioLoop->setReadBudget(readBudget_);
+        }
+        if(option_ == KReusePortSharded)
+        {
+            startShardAcceptors();
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+    }
+}
+
+// 每个subloop(没有subloop的时候就是baseLoop)创建一个SO_REUSEPORT的监听socket
+void TcpServer::startShardAcceptors()
+{
+    shardListen_.reset(new ShardListen);
+    shardListen_->loops = threadPool_->getAllLoops();
+    shardListen_->cpuSteering = cpuSteering_;
+    for(EventLoop *ioLoop : shardListen_->loops)
+    {
+        Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+        acceptor->setEdgeTriggered(edgeTriggered_);
+        acceptor->setMaxAcceptsPerEvent(maxAcceptsPerEvent_);
+        acceptor->setNewConnectionCallback(std::bind(&TcpServer::newShardConnection, this,
+            ioLoop, std::placeholders::_1, std::placeholders::_2));
+        shardAcceptors_.emplace_back(acceptor);
+        shardListen_->acceptors.push_back(acceptor);
+    }
+
+    // 必须在acceptor所属的loop线程里listen(注册channel)
+    // 按顺序一个接一个地listen：内核按照listen的顺序给reuseport组里的socket编号，CBPF返回的下标就是这个编号
+    // 不在这里等listen完成，baseLoop还没有loop的时候从别的线程调用start也不会卡住
+    shardListen_->loops[0]->runInLoop(std::bind(&TcpServer::listenShard, shardListen_, 0));
+}
+
+void TcpServer::newShardConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr)
+{
+    // 连接就是在当前subloop上accept的，直接在当前线程建立连接
+    establishConnection(ioLoop, sockfd, peerAddr);
+}
+
+// acceptor一次可读事件accept到的一批新连接
+void TcpServer::newConnections(const Acceptor::AcceptedList &accepted)
+{
+    /**
+     * 按照负载均衡策略(默认轮询)，给每个连接选择一个subloop,来管理channel
+     * 一致性哈希只用对端ip，同一个客户端的多个连接落到同一个loop
+     * 同一个subloop的连接攒在一起，每个subloop只投递一次回调、最多唤醒一次
+    */
+    std::vector<std::pair<EventLoop*, std::vector<TcpConnectionPtr>>> batches;
+    for(const std::pair<int, InetAddress> &item : accepted)
+    {
+        EventLoop *ioLoop = threadPool_->getNextLoop(item.second.getSockAddr()->sin_addr.s_addr);
+        TcpConnectionPtr conn = createConnection(ioLoop, item.first, item.second);
+
+        size_t i = 0;
+        while(i < batches.size() && batches[i].first != ioLoop)
+        {
+            ++i;
+        }
+        if(i == batches.size())
+        {
+            batches.emplace_back(ioLoop, std::vector<TcpConnectionPtr>());
+        }
+        batches[i].second.push_back(std::move(conn));
+    }
+
+    for(std::pair<EventLoop*, std::vector<TcpConnectionPtr>> &batch : batches)
+    {
+        batch.first->runInLoop(std::bind(&TcpServer::establishConnections, std::move(batch.second)));
+    }
+}
+
+void TcpServer::establishConnections(const std::vector<TcpConnectionPtr> &conns)
+{
+    for(const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
     }
 }
 
-// 有一个新的客户端的连接,acceptor会执行这个回调操作
-void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
+void TcpServer::establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr)
+{
+    TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+    //直接调用
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr)
 {
-    // 轮询算法，选择一个subloop,来管理channel
-    EventLoop *ioLoop = threadPool_->getNextLoop();
     char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    nextConnId_++;
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_++);
     std::string connName = name_ + buf;
 
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
@@ -97,34 +283,114 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
         peerAddr
     ));
 
-    connections_[connName] = conn;
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        connections_[connName] = conn;
+    }
     // 下面的回调都是用户设置给TcpServer => TcpConnection => Channel => Poller => notify => channel回调
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setCork(cork_);
 
     // 设置了如何关闭连接的回调
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
     );
 
-    //直接调用
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, this));
-
+    return conn;
 }
+
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
+    if(option_ == KReusePortSharded)
+    {
+        // 连接的建立和销毁都在它自己的subloop里，不用再转到baseLoop
+        removeConnectionInLoop(conn);
+        return;
+    }
     loop_->runInLoop(
         std::bind(&TcpServer::removeConnectionInLoop, this, conn)
     );
 }
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n"
+    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
         name_.c_str(), conn->name().c_str());
-    connections_.erase(conn->name());
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        connections_.erase(conn->name());
+        // handleClose之后这个连接不会再收发数据了，计数累加到closedStats_
+        closedStats_.connectionsClosed++;
+        closedStats_.bytesReceived += conn->bytesReceived();
+        closedStats_.bytesSent += conn->bytesSent();
+        closedStats_.messagesReceived += conn->messagesReceived();
+        closedStats_.messagesSent += conn->messagesSent();
+        closedStats_.highWaterMarkHits += conn->highWaterMarkHits();
+    }
     EventLoop *ioLoop = conn->getLoop();
     ioLoop->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn)
     );
-}
\ No newline at end of file
+}
+
+void TcpServer::stats(Stats *s)
+{
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        *s = closedStats_;
+        conns.reserve(connections_.size());
+        for(auto &item : connections_)
+        {
+            conns.push_back(item.second);
+        }
+    }
+    // 锁外面读各个连接的计数，不挡住建立和关闭连接
+    for(const TcpConnectionPtr &conn : conns)
+    {
+        s->bytesReceived += conn->bytesReceived();
+        s->bytesSent += conn->bytesSent();
+        s->messagesReceived += conn->messagesReceived();
+        s->messagesSent += conn->messagesSent();
+        s->highWaterMarkHits += conn->highWaterMarkHits();
+    }
+    s->activeConnections = conns.size();
+    s->connectionsAccepted = nextConnId_ - 1;
+    s->acceptErrors = 0;
+    if(acceptor_)
+    {
+        s->acceptErrors += acceptor_->acceptErrors();
+    }
+    for(const std::unique_ptr<Acceptor> &acceptor : shardAcceptors_)
+    {
+        s->acceptErrors += acceptor->acceptErrors();
+    }
+}
+
+std::vector<TcpConnection::Stats> TcpServer::topConnections(size_t n)
+{
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex_);
+        conns.reserve(connections_.size());
+        for(auto &item : connections_)
+        {
+            conns.push_back(item.second);
+        }
+    }
+
+    std::vector<TcpConnection::Stats> result(conns.size());
+    for(size_t i = 0;i < conns.size();i++)
+    {
+        conns[i]->stats(&result[i]);
+    }
+    n = std::min(n, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+        [](const TcpConnection::Stats &a, const TcpConnection::Stats &b) {
+            return a.bytesReceived + a.bytesSent > b.bytesReceived + b.bytesSent;
+        });
+    result.resize(n);
+    return result;
+}
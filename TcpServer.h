@@ -17,6 +17,8 @@
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
+#include <mutex>
 
 // 对外的服务器编程使用的类
 class TcpServer : noncopyable
@@ -28,11 +30,31 @@ public:
     {
         KNoReusePort,
         KReusePort,
+        // 每个subloop各自持有一个SO_REUSEPORT的监听socket，由内核在这些socket之间分配新连接
+        // accept和建立TcpConnection都在同一个subloop线程里完成，不需要再跨线程转交给subloop
+        KReusePortSharded,
     };
 
-    TcpServer(EventLoop* loop
+    /**
+     * 整个server的计数  关闭的连接在removeConnection的时候累加进来，再加上现在还活着的连接
+     * 是各个连接的计数加起来的，不是一个原子的快照，监控够用了
+    */
+    struct Stats
+    {
+        uint64_t connectionsAccepted = 0;
+        uint64_t connectionsClosed = 0;
+        size_t activeConnections = 0;
+        uint64_t acceptErrors = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t bytesSent = 0;
+        uint64_t messagesReceived = 0;
+        uint64_t messagesSent = 0;
+        uint64_t highWaterMarkHits = 0;
+    };
+
+    TcpServer(EventLoop* loop,
             const InetAddress& listenAddr,
-            const string& nameArg,
+            const std::string& nameArg,
             Option option = KNoReusePort);
     
     ~TcpServer();
@@ -40,6 +62,44 @@ public:
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
 
+    // 前numLoops个subloop使用忙轮询，降低跨线程投递和网络事件的延迟  需要在start之前调用
+    void setBusyPoll(int numLoops, int spinUs);
+
+    // 所有loop的读预算，见EventLoop::setReadBudget  需要在start之前调用
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+
+    // 新连接分配给subloop的策略，默认轮询  KConsistentHash按照对端ip哈希  需要在start之前调用
+    // KReusePortSharded模式下连接由内核分配，不经过这里
+    void setLoadBalance(EventLoopThreadPool::LoadBalance strategy);
+
+    // subloop线程绑核，见EventLoopThreadPool::setCpuAffinity/setNumaSpread  需要在start之前调用
+    void setCpuAffinity(const std::vector<int> &cpus);
+    void setNumaSpread(bool on);
+
+    // KReusePortSharded模式下，用reuseport的CBPF程序按照收到SYN的CPU选择监听socket(第i个subloop对应CPU i)
+    // 需要subloop线程绑定到对应的CPU上才有意义  需要在start之前调用
+    void setReusePortCpuSteering(bool on) { cpuSteering_ = on; }
+
+    // 开启边缘触发(EPOLLET)模式，listenfd和所有的连接都使用ET  需要在start之前调用
+    void setEdgeTriggered(bool on);
+
+    // 所有连接开启cork模式，见TcpConnection::setCork  需要在start之前调用
+    void setCork(bool on) { cork_ = on; }
+
+    // LT模式下listenfd每次可读事件最多accept多少个连接，默认Acceptor::KMaxAcceptsPerEvent  需要在start之前调用
+    void setMaxAcceptsPerEvent(int n);
+
+    const std::string& name() const { return name_; }
+    const std::string& ipPort() const { return ipPort_; }
+
+    // 任何线程都可以调用  KReusePortSharded模式下start之后才有acceptErrors
+    void stats(Stats *s);
+    // 收发字节数最多的n个连接的计数  任何线程都可以调用
+    std::vector<TcpConnection::Stats> topConnections(size_t n);
+
+    // 用来读取各个subloop的运行指标，见EventLoopThreadPool::metricsSnapshot
+    std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+
     void setThreadInitcallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
@@ -48,16 +108,33 @@ public:
     // 开启服务器监听
     void start();
 private:
-    void newConnection(int sockfd, const InetAddress& peerAddr);
+    // acceptor一次可读事件accept到的一批新连接
+    void newConnections(const Acceptor::AcceptedList &accepted);
+    // KReusePortSharded模式下，ioLoop自己的acceptor收到了新连接
+    void newShardConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr);
+    // 在ioLoop上为sockfd创建TcpConnection
+    void establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr);
+    // 创建TcpConnection并加入connections_，还没有注册到ioLoop的poller上
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress& peerAddr);
+    // 在ioLoop线程里把同一批的连接注册到poller上
+    static void establishConnections(const std::vector<TcpConnectionPtr> &conns);
+    void startShardAcceptors();
+    struct ShardListen;
+    static void listenShard(const std::shared_ptr<ShardListen> &state, size_t i);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
 
     EventLoop *loop_; // baseLoop 用户定义的loop
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
-    std::unique_lock<Acceptor> acceptor_; // 运行在mainloop, 任务就是监听新连接事件
+    const Option option_;
+    std::unique_ptr<Acceptor> acceptor_; // 运行在mainloop, 任务就是监听新连接事件  KReusePortSharded模式下为空
+    std::vector<std::unique_ptr<Acceptor>> shardAcceptors_; // KReusePortSharded模式下每个subloop一个
+    std::shared_ptr<ShardListen> shardListen_; // shardAcceptors_按顺序listen的进度
+    bool cpuSteering_;
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
     ConnectionCallback connectionCallback_; // 有新连接时的回调
@@ -68,8 +145,15 @@ private:
 
     std::atomic_int started_;
 
-    int nextConnId_;
+    std::atomic_int nextConnId_;
+    bool edgeTriggered_;
+    bool cork_;
+    int maxAcceptsPerEvent_;
+    size_t readBudget_;
+    // KReusePortSharded模式下各个subloop会同时增删连接，所以加锁保护
+    std::mutex connectionsMutex_;
     ConnectionMap connections_; // 保存所有的连接
+    Stats closedStats_; // 已经关闭的连接的计数之和  也由connectionsMutex_保护
 
 
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "Thread.h"
 #include "CurrentThread.h"
+#include "Logger.h"
 
 #include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
 
 std::atomic_int Thread::numCreated_(0);
 
@@ -12,7 +15,7 @@ Thread::Thread(ThreadFunc func, const std::string &name)
     , func_(std::move(func))
     , name_(name)
     {
-
+        setDefaultName();
     }
     
 Thread::~Thread()
@@ -31,6 +34,23 @@ void Thread::start() //一个thread对象，记录的就是一个新线程的详
     thread_ = std::shared_ptr<std::thread>(new std::thread([&](){
         // 获取线程的tid值
         tid_ = CurrentThread::tid();
+        // 线程名最长15个字符，top -H / perf里能看到
+        ::pthread_setname_np(::pthread_self(), name_.substr(0, 15).c_str());
+        // 在执行线程函数之前绑核，之后这个线程分配并第一次写的内存都在本地NUMA节点上
+        if(!cpus_.empty())
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            for(int cpu : cpus_)
+            {
+                CPU_SET(cpu, &cpuset);
+            }
+            int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof cpuset, &cpuset);
+            if(ret != 0)
+            {
+                LOG_ERROR("Thread %s setaffinity errno:%d \n", name_.c_str(), ret);
+            }
+        }
         sem_post(&sem);
 
         func_(); // 开启一个新线程，专门执行该线程函数
@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <string>
 #include <atomic>
+#include <vector>
 
 /**
  * 最重要的就是：ThreadFunc : 线程执行函数
@@ -18,15 +19,18 @@ class Thread : noncopyable
 public:
     using ThreadFunc = std::function<void()>;
 
-    explicit Thread(ThreadFunc, const std::string &name = string());
+    explicit Thread(ThreadFunc, const std::string &name = std::string());
     ~Thread();
 
     void start();
     void join();
 
+    // 把线程绑定到cpus中的这些CPU上(sched_setaffinity)，空表示不绑定  需要在start之前调用
+    void setCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+
     bool started() const { return started_; }
     pid_t tid() const { return tid_; } // top -Hp 进程id   打印出来的线程id
-    const string& name() const { return name_; }
+    const std::string& name() const { return name_; }
 
     static int numCreated() { return numCreated_; }
 
@@ -39,6 +43,7 @@ private:
     pid_t tid_;
     ThreadFunc func_;
     std::string name_;
-    static std::atomic_int32 numCreated_; // 对线程数量进行计数
+    std::vector<int> cpus_;
+    static std::atomic_int numCreated_; // 对线程数量进行计数
 
 };
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+
+// 定时器  记录超时时间、回调以及是否重复
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++numCreated_)
+        , heapIndex_(-1)
+        {}
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器，以now为起点重新计算下一次的超时时间
+    void restart(Timestamp now);
+
+    // 在TimerQueue的小根堆中的下标，-1表示不在堆中
+    int heapIndex() const { return heapIndex_; }
+    void set_heapIndex(int index) { heapIndex_ = index; }
+
+    static int64_t numCreated() { return numCreated_; }
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;
+    const double interval_;
+    const bool repeat_;
+    const int64_t sequence_; // 全局唯一的序号，用来区分地址被复用的Timer对象
+    int heapIndex_;
+
+    static std::atomic<int64_t> numCreated_;
+};
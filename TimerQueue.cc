@@ -0,0 +1,254 @@
+#include "TimerQueue.h"
+#include "Timer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <strings.h>
+#include <errno.h>
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(timerfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d timerfd_create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return timerfd;
+}
+
+// 计算when距离现在还有多久，最少100微秒，避免设置成0把timerfd关掉
+static struct timespec howMuchTimeFromNow(Timestamp when)
+{
+    int64_t microseconds = when.microSecondsSinceEpoch()
+                         - Timestamp::now().microSecondsSinceEpoch();
+    if(microseconds < 100)
+    {
+        microseconds = 100;
+    }
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return ts;
+}
+
+static void readTimerfd(int timerfd)
+{
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd, &howmany, sizeof howmany);
+    if(n != sizeof howmany)
+    {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8", n);
+    }
+}
+
+// 重新设置timerfd的超时时间
+static void resetTimerfd(int timerfd, Timestamp expiration)
+{
+    struct itimerspec newValue;
+    struct itimerspec oldValue;
+    bzero(&newValue, sizeof newValue);
+    bzero(&oldValue, sizeof oldValue);
+    newValue.it_value = howMuchTimeFromNow(expiration);
+    if(::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0)
+    {
+        LOG_ERROR("timerfd_settime err:%d \n", errno);
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , callingExpiredTimers_(false)
+    {
+        timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+        // 和wakeupChannel一样，一直监听timerfd的读事件
+        timerfdChannel_.enableReading();
+    }
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for(Timer *timer : heap_)
+    {
+        delete timer;
+    }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+{
+    Timer *timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer)
+{
+    bool earliestChanged = insert(timer);
+    if(earliestChanged)
+    {
+        resetTimerfd(timerfd_, timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    auto it = timers_.find(timerId.sequence_);
+    if(it == timers_.end())
+    {
+        return; // 已经到期删除了，或者已经被取消过了
+    }
+
+    Timer *timer = it->second;
+    if(timer->heapIndex() >= 0)
+    {
+        heapRemove(timer->heapIndex());
+        timers_.erase(it);
+        delete timer;
+        // 堆顶被删掉了也不用重新设置timerfd，最多多醒一次
+    }
+    else if(callingExpiredTimers_)
+    {
+        // 定时器正在执行回调(在自己的回调里取消自己)，等reset的时候再删除
+        cancelingTimers_.insert(timerId.sequence_);
+    }
+}
+
+void TimerQueue::handleRead()
+{
+    Timestamp now(Timestamp::now());
+    readTimerfd(timerfd_);
+
+    std::vector<Timer*> expired;
+    getExpired(now, &expired);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for(const Timer *timer : expired)
+    {
+        timer->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+void TimerQueue::getExpired(Timestamp now, std::vector<Timer*> *expired)
+{
+    while(!heap_.empty() && !(now < heap_.front()->expiration()))
+    {
+        expired->push_back(heap_.front());
+        heapRemove(0);
+    }
+}
+
+void TimerQueue::reset(const std::vector<Timer*> &expired, Timestamp now)
+{
+    for(Timer *timer : expired)
+    {
+        if(timer->repeat() && cancelingTimers_.find(timer->sequence()) == cancelingTimers_.end())
+        {
+            timer->restart(now);
+            insert(timer);
+        }
+        else
+        {
+            timers_.erase(timer->sequence());
+            delete timer;
+        }
+    }
+
+    if(!heap_.empty())
+    {
+        resetTimerfd(timerfd_, heap_.front()->expiration());
+    }
+}
+
+bool TimerQueue::insert(Timer *timer)
+{
+    bool earliestChanged = heap_.empty() || timer->expiration() < heap_.front()->expiration();
+    heapPush(timer);
+    timers_[timer->sequence()] = timer;
+    return earliestChanged;
+}
+
+void TimerQueue::heapPush(Timer *timer)
+{
+    heap_.push_back(timer);
+    timer->set_heapIndex(static_cast<int>(heap_.size()) - 1);
+    siftUp(timer->heapIndex());
+}
+
+// 把index位置的定时器从堆中摘下来，用堆尾元素填补空位后重新调整
+void TimerQueue::heapRemove(int index)
+{
+    int last = static_cast<int>(heap_.size()) - 1;
+    Timer *removed = heap_[index];
+    if(index != last)
+    {
+        heapSwap(index, last);
+    }
+    heap_.pop_back();
+    removed->set_heapIndex(-1);
+
+    if(index < static_cast<int>(heap_.size()))
+    {
+        siftDown(index);
+        siftUp(index);
+    }
+}
+
+void TimerQueue::siftUp(int index)
+{
+    while(index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if(!(heap_[index]->expiration() < heap_[parent]->expiration()))
+        {
+            break;
+        }
+        heapSwap(index, parent);
+        index = parent;
+    }
+}
+
+void TimerQueue::siftDown(int index)
+{
+    int n = static_cast<int>(heap_.size());
+    while(true)
+    {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if(left < n && heap_[left]->expiration() < heap_[smallest]->expiration())
+        {
+            smallest = left;
+        }
+        if(right < n && heap_[right]->expiration() < heap_[smallest]->expiration())
+        {
+            smallest = right;
+        }
+        if(smallest == index)
+        {
+            break;
+        }
+        heapSwap(index, smallest);
+        index = smallest;
+    }
+}
+
+void TimerQueue::heapSwap(int i, int j)
+{
+    std::swap(heap_[i], heap_[j]);
+    heap_[i]->set_heapIndex(i);
+    heap_[j]->set_heapIndex(j);
+}
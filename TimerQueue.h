@@ -0,0 +1,63 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+#include "TimerId.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+class EventLoop;
+class Timer;
+
+/**
+ * 每个EventLoop一个TimerQueue
+ * timerfd作为一个Channel注册到loop的Poller上，到期的时候和其它fd一样通过poll返回
+ * 定时器按照超时时间组织成小根堆，堆顶就是最早到期的定时器，timerfd总是设置成堆顶的超时时间
+ * 所有的增删操作都在loop所在的线程中完成，不需要加锁
+*/
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 可以跨线程调用
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+    size_t size() const { return heap_.size(); }
+private:
+    using TimerHeap = std::vector<Timer*>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读，有定时器到期了
+    void handleRead();
+
+    // 把所有超时时间<=now的定时器从堆里取出来
+    void getExpired(Timestamp now, std::vector<Timer*> *expired);
+    void reset(const std::vector<Timer*> &expired, Timestamp now);
+    // 插入定时器，返回堆顶是否发生了变化(timerfd需要重新设置)
+    bool insert(Timer *timer);
+
+    // 小根堆的操作
+    void heapPush(Timer *timer);
+    void heapRemove(int index);
+    void siftUp(int index);
+    void siftDown(int index);
+    void heapSwap(int i, int j);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerHeap heap_; // 按超时时间排列的小根堆
+    std::unordered_map<int64_t, Timer*> timers_; // key: sequence  所有还活着的定时器
+
+    bool callingExpiredTimers_; // 是否正在执行到期定时器的回调
+    std::unordered_set<int64_t> cancelingTimers_; // 在回调里面被取消的定时器，不能再restart
+};
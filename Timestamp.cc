@@ -1,6 +1,8 @@
 #include "Timestamp.h"
 
 #include <time.h>
+#include <stdio.h>
+#include <sys/time.h>
 
 Timestamp::Timestamp():microSecondsSinceEpoch_(0) {}
 Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
@@ -8,19 +10,38 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
     {}
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL)); 
+    // 定时器需要微秒级的精度，time(NULL)只能精确到秒
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return Timestamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec);
+}
+Timestamp Timestamp::nowCoarse()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
 }
 std::string Timestamp::toString() const
+{
+    return toFormattedString(false);
+}
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
 {
     char buf[128] = {0};
-    // asctime(localtime(&time(NULL)));
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
+    // localtime返回的是静态的缓冲区，多个线程同时调用不安全，用localtime_r
+    time_t seconds = secondsSinceEpoch();
+    struct tm tm_time;
+    localtime_r(&seconds, &tm_time);
+    int n = snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
+        tm_time.tm_year + 1900,
+        tm_time.tm_mon + 1,
+        tm_time.tm_mday,
+        tm_time.tm_hour,
+        tm_time.tm_min,
+        tm_time.tm_sec);
+    if(showMicroseconds)
+    {
+        snprintf(buf + n, 128 - n, ".%06d", static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond));
+    }
     return buf;
-}
\ No newline at end of file
+}
@@ -1,14 +1,93 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <stdint.h>
+#include <time.h>
 
+// 墙上时间  微秒精度，只有一个int64_t，按值传递
 class Timestamp
 {
 public:
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);
     static Timestamp now();
+    /**
+     * CLOCK_REALTIME_COARSE  只读内核每个tick更新一次的时间，不读时钟硬件，比now()便宜很多
+     * 精度是一个tick(1~4ms)，给秒级的日志时间、连接的存活时间这类不要求精度的地方用
+    */
+    static Timestamp nowCoarse();
+    static Timestamp fromUnixTime(time_t seconds, int microseconds = 0)
+    {
+        return Timestamp(static_cast<int64_t>(seconds) * kMicroSecondsPerSecond + microseconds);
+    }
+    // 2026/01/02 03:04:05
     std::string toString() const;
+    // 2026/01/02 03:04:05.123456
+    std::string toFormattedString(bool showMicroseconds = true) const;
+
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond); }
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+
+    Timestamp& operator+=(int64_t microSeconds)
+    {
+        microSecondsSinceEpoch_ += microSeconds;
+        return *this;
+    }
+    Timestamp& operator-=(int64_t microSeconds)
+    {
+        microSecondsSinceEpoch_ -= microSeconds;
+        return *this;
+    }
+
+    static Timestamp invalid() { return Timestamp(); }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator!=(Timestamp lhs, Timestamp rhs) { return !(lhs == rhs); }
+inline bool operator>(Timestamp lhs, Timestamp rhs) { return rhs < lhs; }
+inline bool operator<=(Timestamp lhs, Timestamp rhs) { return !(rhs < lhs); }
+inline bool operator>=(Timestamp lhs, Timestamp rhs) { return !(lhs < rhs); }
+
+// 两个时间点相差的微秒数
+inline int64_t operator-(Timestamp high, Timestamp low)
+{
+    return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+inline Timestamp operator+(Timestamp timestamp, int64_t microSeconds)
+{
+    return timestamp += microSeconds;
+}
+
+inline Timestamp operator-(Timestamp timestamp, int64_t microSeconds)
+{
+    return timestamp -= microSeconds;
+}
+
+// 两个时间点相差的秒数
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    return static_cast<double>(high - low) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 给定时器用的，在timestamp的基础上加上seconds秒
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,103 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * 短连接建连压测  用来对比单个acceptor和每个subloop一个SO_REUSEPORT的acceptor
+ * ./acceptbench [模式 0:单acceptor 1:sharded 2:sharded+CPU steering] [server线程数] [client线程数] [秒数]
+ * client每次connect成功后用SO_LINGER 0直接RST关闭，避免大量TIME_WAIT耗尽端口
+*/
+static std::atomic<int64_t> g_accepted(0);
+static std::atomic<bool> g_stop(false);
+
+static void clientThread(uint16_t port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    linger lg;
+    lg.l_onoff = 1;
+    lg.l_linger = 0;
+    while(!g_stop)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0)
+        {
+            perror("socket");
+            exit(1);
+        }
+        if(::connect(fd, (sockaddr*)&addr, sizeof addr) == 0)
+        {
+            ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        }
+        ::close(fd);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : 1;
+    int serverThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int clientThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    uint16_t port = 9982;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "AcceptBench",
+            mode == 0 ? TcpServer::KReusePort : TcpServer::KReusePortSharded);
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+            if(conn->connected())
+            {
+                ++g_accepted;
+            }
+        });
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            buf->retrieveAll();
+        });
+        server.setThreadNum(serverThreads);
+        server.setReusePortCpuSteering(mode == 2);
+        server.start();
+        loop.runAfter(seconds + 2, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    std::vector<std::thread> clients;
+    for(int i = 0;i < clientThreads;i++)
+    {
+        clients.emplace_back(clientThread, port);
+    }
+
+    int64_t last = 0;
+    for(int s = 0;s < seconds;s++)
+    {
+        ::sleep(1);
+        int64_t now = g_accepted;
+        fprintf(stderr, "accepted/s: %ld\n", now - last);
+        last = now;
+    }
+    g_stop = true;
+    for(std::thread &t : clients)
+    {
+        t.join();
+    }
+    server.join();
+    printf("mode=%s server threads=%d avg accepted/s: %ld\n",
+        mode == 0 ? "single" : (mode == 1 ? "sharded" : "sharded+steering"),
+        serverThreads, last / seconds);
+    return 0;
+}
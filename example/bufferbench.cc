@@ -0,0 +1,110 @@
+#include <mymuduo/Buffer.h>
+#include <mymuduo/ChainBuffer.h>
+#include <mymuduo/Timestamp.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/**
+ * 发送路径压测  对比连续的Buffer(拼接header + body + trailer再write)和ChainBuffer(body不拷贝，writev)
+ * ./bufferbench [每种消息大小发送的总MB数]
+ * 消息大小从4KB到16MB，另一个线程从socketpair的另一端读走数据
+*/
+static const size_t KHeaderSize = 16;
+static const size_t KTrailerSize = 4;
+
+static void drain(int fd)
+{
+    std::vector<char> buf(1024 * 1024);
+    while(::read(fd, buf.data(), buf.size()) > 0)
+    {
+    }
+}
+
+static double benchBuffer(int fd, const std::string &header, const std::string &body, const std::string &trailer, size_t count)
+{
+    Buffer buf;
+    Timestamp start = Timestamp::now();
+    for(size_t i = 0;i < count;i++)
+    {
+        buf.append(header.data(), header.size());
+        buf.append(body.data(), body.size());
+        buf.append(trailer.data(), trailer.size());
+        while(buf.readableBytes() > 0)
+        {
+            int savedErrno = 0;
+            ssize_t n = buf.writeFd(fd, &savedErrno);
+            if(n <= 0)
+            {
+                perror("write");
+                exit(1);
+            }
+            buf.retrieve(n);
+        }
+    }
+    return (Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+}
+
+static double benchChain(int fd, const std::string &header, const std::shared_ptr<std::string> &body, const std::string &trailer, size_t count)
+{
+    ChainBuffer buf;
+    Timestamp start = Timestamp::now();
+    for(size_t i = 0;i < count;i++)
+    {
+        buf.append(header);
+        buf.appendSlice(body->data(), body->size(), body);
+        buf.append(trailer);
+        while(buf.readableBytes() > 0)
+        {
+            int savedErrno = 0;
+            ssize_t n = buf.writeFd(fd, &savedErrno);
+            if(n <= 0)
+            {
+                perror("writev");
+                exit(1);
+            }
+            buf.retrieve(n);
+        }
+    }
+    return (Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t totalMB = argc > 1 ? atoi(argv[1]) : 512;
+    std::string header(KHeaderSize, 'h');
+    std::string trailer(KTrailerSize, 't');
+
+    for(size_t size = 4 * 1024;size <= 16 * 1024 * 1024;size *= 4)
+    {
+        std::shared_ptr<std::string> body(new std::string(size, 'b'));
+        size_t count = totalMB * 1024 * 1024 / size;
+        if(count == 0)
+        {
+            count = 1;
+        }
+        double mb = count * (size + KHeaderSize + KTrailerSize) / (1024.0 * 1024.0);
+
+        double seconds[2];
+        for(int round = 0;round < 2;round++)
+        {
+            int fds[2];
+            ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+            std::thread reader(drain, fds[1]);
+            seconds[round] = round == 0 ? benchBuffer(fds[0], header, *body, trailer, count)
+                                        : benchChain(fds[0], header, body, trailer, count);
+            ::close(fds[0]);
+            reader.join();
+            ::close(fds[1]);
+        }
+        printf("msg=%8zu  Buffer: %8.1f MB/s  ChainBuffer: %8.1f MB/s\n",
+            size, mb / seconds[0], mb / seconds[1]);
+    }
+    return 0;
+}
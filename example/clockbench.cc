@@ -0,0 +1,99 @@
+#include <mymuduo/Timestamp.h>
+#include <mymuduo/Clock.h>
+#include <mymuduo/Logger.h>
+#include <mymuduo/EventLoop.h>
+
+#include <string>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+/**
+ * 各种取时间的方法每次多少ns，以及日志行首的开销
+ * ./clockbench [次数]
+ * 1. Timestamp::now(gettimeofday) / Timestamp::nowCoarse / CLOCK_MONOTONIC / CLOCK_MONOTONIC_COARSE / rdtsc / TscClock::nowNs / EventLoop::loopTime
+ * 2. 日志行首：原来每一行都 Timestamp::now().toString() + snprintf，现在每个线程缓存这一秒的日期
+ * 3. 一整条文本LOG_INFO(输出端什么都不做)
+ * 4. TscClock和CLOCK_MONOTONIC量同一段时间的误差
+*/
+static volatile int64_t g_sink = 0;
+
+static double measure(const char *name, int count, const std::function<int64_t()> &func)
+{
+    int64_t sum = 0;
+    int64_t start = Clock::monotonicNs();
+    for(int i = 0;i < count;i++)
+    {
+        sum += func();
+    }
+    double ns = static_cast<double>(Clock::monotonicNs() - start) / count;
+    g_sink = sum;
+    printf("%-40s %8.2f ns\n", name, ns);
+    return ns;
+}
+
+// 改之前Logger::logText的行首
+static int oldPrefix(int level, char *buf, size_t size)
+{
+    return snprintf(buf, size, "%s%s : ", Logger::levelName(level), Timestamp::now().toString().c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+    int slowCount = count / 10; // 原来的行首太慢，少跑一些
+
+    printf("TSC: %s  %.3f GHz   CLOCK_MONOTONIC_COARSE resolution %.3f ms\n",
+        TscClock::available() ? "invariant" : "not available", TscClock::ticksPerSecond() / 1e9,
+        Clock::coarseResolutionNs() / 1e6);
+
+    // 函数对象的调用本身也计在里面，先量一个空的
+    measure("(empty functor)", count, []() { return static_cast<int64_t>(1); });
+    measure("Timestamp::now (gettimeofday)", count, []() { return Timestamp::now().microSecondsSinceEpoch(); });
+    measure("Timestamp::nowCoarse", count, []() { return Timestamp::nowCoarse().microSecondsSinceEpoch(); });
+    measure("Clock::monotonicNs", count, []() { return Clock::monotonicNs(); });
+    measure("Clock::coarseNs", count, []() { return Clock::coarseNs(); });
+    measure("TscClock::ticks (rdtsc)", count, []() { return static_cast<int64_t>(TscClock::ticks()); });
+    measure("TscClock::nowNs", count, []() { return TscClock::nowNs(); });
+    {
+        EventLoop loop;
+        measure("EventLoop::loopTime", count, [&loop]() { return loop.loopTime().microSecondsSinceEpoch(); });
+    }
+
+    char buf[256];
+    measure("log prefix: now().toString()+snprintf", slowCount, [&buf]() {
+        return static_cast<int64_t>(oldPrefix(INFO, buf, sizeof buf));
+    });
+    measure("log prefix: Logger::formatPrefix", count, [&buf]() {
+        return static_cast<int64_t>(Logger::formatPrefix(INFO, buf, sizeof buf));
+    });
+    size_t len = Logger::formatPrefix(INFO, buf, sizeof buf);
+    char old[256];
+    oldPrefix(INFO, old, sizeof old);
+    printf("  new \"%.*s\"  old \"%s\"\n", static_cast<int>(len), buf, old);
+
+    Logger::setLogLevel(INFO);
+    Logger::instance().setOutput([](const char *msg, size_t len) { g_sink += len; });
+    measure("LOG_INFO text line", slowCount, []() {
+        LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", "conn-127.0.0.1:9981#42", 42);
+        return static_cast<int64_t>(0);
+    });
+
+    // 同一段sleep，两个时钟量出来的差
+    int64_t tsc0 = TscClock::nowNs();
+    int64_t mono0 = Clock::monotonicNs();
+    ::usleep(200 * 1000);
+    int64_t tsc1 = TscClock::nowNs();
+    int64_t mono1 = Clock::monotonicNs();
+    printf("200ms sleep: CLOCK_MONOTONIC %.3f ms  TscClock %.3f ms  diff %.1f us\n",
+        (mono1 - mono0) / 1e6, (tsc1 - tsc0) / 1e6, ((tsc1 - tsc0) - (mono1 - mono0)) / 1e3);
+
+    Timestamp a = Timestamp::now();
+    Timestamp b = a + 1500000;
+    printf("Timestamp: %s + 1.5s = %s  diff %.1fs  %s\n", a.toFormattedString().c_str(),
+        b.toFormattedString().c_str(), timeDifference(b, a), b > a ? "b > a" : "b <= a");
+    return 0;
+}
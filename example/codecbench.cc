@@ -0,0 +1,87 @@
+#include <mymuduo/LengthHeaderCodec.h>
+#include <mymuduo/Crc32c.h>
+#include <mymuduo/Buffer.h>
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * 长度头分帧压测  小帧的编码/解码速度(帧/秒)，不走网络
+ * ./codecbench
+ * 对比 不校验 / CRC32C硬件(SSE4.2) / CRC32C查表 三种情况，帧大小16B ~ 1KB
+ * 解码: 一个Buffer里放1024个完整的帧，onMessage一次全部回调出来
+*/
+static const int KFramesPerBatch = 1024;
+static const int KBatches = 2000;
+
+static size_t g_frames = 0;
+static size_t g_bytes = 0;
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void onFrame(const TcpConnectionPtr&, const char *data, size_t len, Timestamp)
+{
+    ++g_frames;
+    g_bytes += len;
+}
+
+static void run(const char *name, bool checksum, size_t frameSize)
+{
+    LengthHeaderCodec codec(onFrame, LengthHeaderCodec::KDefaultMaxFrameSize, checksum);
+    std::string payload(frameSize, 'f');
+
+    // 编码
+    Buffer wire;
+    double start = nowSec();
+    for(int b = 0;b < KBatches;b++)
+    {
+        wire.retrieveAll();
+        for(int i = 0;i < KFramesPerBatch;i++)
+        {
+            codec.appendFrame(&wire, payload.data(), payload.size());
+        }
+    }
+    double encodeSec = nowSec() - start;
+
+    // 解码
+    TcpConnectionPtr noConn;
+    g_frames = 0;
+    start = nowSec();
+    for(int b = 0;b < KBatches;b++)
+    {
+        Buffer input(wire);
+        codec.onMessage(noConn, &input, Timestamp());
+    }
+    double decodeSec = nowSec() - start;
+
+    double total = static_cast<double>(KBatches) * KFramesPerBatch;
+    printf("%-8s %5zuB  encode %6.2f Mframes/s  decode %6.2f Mframes/s%s\n",
+        name, frameSize, total / encodeSec / 1e6, total / decodeSec / 1e6,
+        g_frames == static_cast<size_t>(total) ? "" : "  FRAMES LOST");
+}
+
+int main()
+{
+    const size_t sizes[] = { 16, 64, 256, 1024 };
+    bool hardware = Crc32c::hardwareAccelerated();
+    for(size_t size : sizes)
+    {
+        run("none", false, size);
+        if(hardware)
+        {
+            Crc32c::setHardwareAccelerated(true);
+            run("crc32c", true, size);
+        }
+        Crc32c::setHardwareAccelerated(false);
+        run("crc-tab", true, size);
+        Crc32c::setHardwareAccelerated(hardware);
+    }
+    return 0;
+}
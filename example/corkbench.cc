@@ -0,0 +1,178 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/CurrentThread.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * cork模式压测  流水线的小请求/小响应
+ * ./corkbench [模式 0:普通 1:cork 2:cork+每个响应flush] [连接数] [流水线深度] [响应body字节数] [秒数] [TCP_NODELAY 0/1]
+ * client每个连接一次write发出 流水线深度 个16字节的请求，收齐所有响应之后再发下一批
+ * server每个请求回复一个响应，header(8字节)和body分两次send
+ * 不开TCP_NODELAY的时候普通模式下body会被Nagle拖到client的delayed ack之后(40ms)，cork模式一次writev发出去没有这个问题
+ * 写系统调用次数取自server的subloop线程的/proc/self/task/<tid>/io(syscw，write/writev/sendmsg都算)
+ * 全部系统调用可以用 strace -c -f -p <pid> 看
+*/
+static const size_t KRequestSize = 16;
+static const size_t KHeaderSize = 8;
+
+static std::atomic<int64_t> g_responses(0);
+static std::atomic<bool> g_stop(false);
+static std::atomic<int> g_ioTid(0);
+
+static int64_t writeSyscalls(int tid)
+{
+    char path[64];
+    snprintf(path, sizeof path, "/proc/self/task/%d/io", tid);
+    FILE *fp = ::fopen(path, "r");
+    if(fp == nullptr)
+    {
+        return 0;
+    }
+    char line[128];
+    int64_t syscw = 0;
+    while(::fgets(line, sizeof line, fp) != nullptr)
+    {
+        if(sscanf(line, "syscw: %ld", &syscw) == 1)
+        {
+            break;
+        }
+    }
+    ::fclose(fp);
+    return syscw;
+}
+
+static void clientThread(int numConns, uint16_t port, int depth, size_t responseSize)
+{
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::string batch(KRequestSize * depth, 'q');
+    std::vector<size_t> received(numConns, 0);
+    std::vector<int> fds;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    for(int i = 0;i < numConns;i++)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+        ::write(fd, batch.data(), batch.size());
+    }
+
+    size_t batchResponseSize = responseSize * depth;
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(256 * 1024);
+    while(!g_stop)
+    {
+        int n = ::epoll_wait(epfd, events.data(), events.size(), 100);
+        for(int i = 0;i < n;i++)
+        {
+            int idx = events[i].data.u32;
+            ssize_t r = ::read(fds[idx], buf.data(), buf.size());
+            if(r <= 0)
+            {
+                continue;
+            }
+            received[idx] += r;
+            if(received[idx] >= batchResponseSize) // 这一批的响应收齐了，发下一批
+            {
+                received[idx] -= batchResponseSize;
+                g_responses += depth;
+                ::write(fds[idx], batch.data(), batch.size());
+            }
+        }
+    }
+
+    for(int fd : fds)
+    {
+        ::close(fd);
+    }
+    ::close(epfd);
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : 1;
+    int numConns = argc > 2 ? atoi(argv[2]) : 64;
+    int depth = argc > 3 ? atoi(argv[3]) : 16;
+    size_t bodySize = argc > 4 ? atoi(argv[4]) : 56;
+    int seconds = argc > 5 ? atoi(argv[5]) : 5;
+    bool noDelay = argc > 6 ? atoi(argv[6]) != 0 : true;
+    uint16_t port = 9985;
+
+    std::string header(KHeaderSize, 'h');
+    std::string body(bodySize, 'b');
+
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "CorkBench");
+        server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if(conn->connected())
+            {
+                conn->setTcpNoDelay(noDelay);
+            }
+        });
+        server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            while(buf->readableBytes() >= KRequestSize)
+            {
+                buf->retrieve(KRequestSize);
+                conn->send(header);
+                conn->send(body);
+                if(mode == 2)
+                {
+                    conn->flush();
+                }
+            }
+        });
+        server.setThreadInitcallback([](EventLoop *) { g_ioTid = CurrentThread::tid(); });
+        server.setThreadNum(1);
+        server.setCork(mode != 0);
+        server.start();
+        loop.runAfter(seconds + 2, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    std::thread client(clientThread, numConns, port, depth, KHeaderSize + bodySize);
+    ::sleep(1); // 预热
+
+    int64_t startResponses = g_responses;
+    int64_t startWrites = writeSyscalls(g_ioTid);
+    ::sleep(seconds);
+    int64_t responses = g_responses - startResponses;
+    int64_t writes = writeSyscalls(g_ioTid) - startWrites;
+
+    g_stop = true;
+    client.join();
+    server.join();
+    const char *names[] = { "plain", "cork", "cork+flush" };
+    printf("mode=%s nodelay=%d conns=%d depth=%d body=%zu responses/s: %ld  server writes/response: %.3f\n",
+        names[mode], noDelay, numConns, depth, bodySize, responses / seconds,
+        responses > 0 ? static_cast<double>(writes) / responses : 0.0);
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * echo压测  用来对比不同的Poller(和各种发送/接收路径)
+ * ./echobench [连接数] [server线程数] [client线程数] [秒数] [消息大小] [ET模式 0/1] [负载均衡策略 0-4] [绑核 0:不绑 1:按顺序 2:NUMA交错]
+ * MUDUO_USE_IO_URING=1 ./echobench 10000  对比 ./echobench 10000
+ * 同时用 strace -c -f 可以看到两种Poller系统调用次数的差别
+*/
+static std::atomic<int64_t> g_roundTrips(0);
+static std::atomic<bool> g_stop(false);
+
+static void clientThread(int numConns, uint16_t port, size_t msgSize)
+{
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<char> msg(msgSize, 'x');
+    std::vector<size_t> received(numConns, 0);
+    std::vector<int> fds;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    for(int i = 0;i < numConns;i++)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+        ::write(fd, msg.data(), msg.size());
+    }
+
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(64 * 1024);
+    while(!g_stop)
+    {
+        int n = ::epoll_wait(epfd, events.data(), events.size(), 100);
+        for(int i = 0;i < n;i++)
+        {
+            int idx = events[i].data.u32;
+            ssize_t r = ::read(fds[idx], buf.data(), buf.size());
+            if(r <= 0)
+            {
+                continue;
+            }
+            received[idx] += r;
+            if(received[idx] >= msgSize) // 收到了完整的回显，发下一个
+            {
+                received[idx] -= msgSize;
+                ++g_roundTrips;
+                ::write(fds[idx], msg.data(), msg.size());
+            }
+        }
+    }
+
+    for(int fd : fds)
+    {
+        ::close(fd);
+    }
+    ::close(epfd);
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 10000;
+    int serverThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int clientThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    size_t msgSize = argc > 5 ? atoi(argv[5]) : 64;
+    bool edgeTriggered = argc > 6 && atoi(argv[6]) != 0;
+    int loadBalance = argc > 7 ? atoi(argv[7]) : EventLoopThreadPool::KRoundRobin;
+    int pinning = argc > 8 ? atoi(argv[8]) : 0;
+    uint16_t port = 9981;
+
+    rlimit rl;
+    rl.rlim_cur = rl.rlim_max = numConns * 2 + 1024;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "EchoBench");
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf->retrieveAllAsString());
+        });
+        server.setThreadNum(serverThreads);
+        server.setEdgeTriggered(edgeTriggered);
+        server.setLoadBalance(static_cast<EventLoopThreadPool::LoadBalance>(loadBalance));
+        if(pinning == 1)
+        {
+            std::vector<int> cpus;
+            for(int i = 0;i < serverThreads;i++)
+            {
+                cpus.push_back(i);
+            }
+            server.setCpuAffinity(cpus);
+        }
+        server.setNumaSpread(pinning == 2);
+        server.start();
+        loop.runAfter(seconds + 2, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    std::vector<std::thread> clients;
+    for(int i = 0;i < clientThreads;i++)
+    {
+        clients.emplace_back(clientThread, numConns / clientThreads, port, msgSize);
+    }
+
+    int64_t last = 0;
+    for(int s = 0;s < seconds;s++)
+    {
+        ::sleep(1);
+        int64_t now = g_roundTrips;
+        fprintf(stderr, "round trips/s: %ld\n", now - last);
+        last = now;
+    }
+    g_stop = true;
+    for(std::thread &t : clients)
+    {
+        t.join();
+    }
+    server.join();
+    printf("poller=%s%s lb=%d pin=%d conns=%d msg=%zu avg round trips/s: %ld\n",
+        ::getenv("MUDUO_USE_IO_URING") ? "io_uring" : "epoll", edgeTriggered ? "(ET)" : "",
+        loadBalance, pinning, numConns, msgSize, last / seconds);
+    return 0;
+}
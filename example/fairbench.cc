@@ -0,0 +1,157 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/**
+ * 读公平性压测  同一个loop上一个大流量的连接 + 很多个小的请求/响应连接，看小连接的尾延迟
+ * ./fairbench [读预算KB 0:不限制] [ET模式 0/1] [小连接数] [秒数]
+ * 大流量连接一直发'B'，服务端直接丢弃；小连接发16字节的ping，服务端原样回显
+*/
+static const size_t KPingSize = 16;
+
+static std::atomic<bool> g_stop(false);
+static std::atomic<int64_t> g_bulkBytes(0);
+static std::mutex g_mutex;
+static std::vector<int64_t> g_samples;
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static int connectTo(uint16_t port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+static void bulkThread(uint16_t port)
+{
+    int fd = connectTo(port);
+    std::vector<char> buf(1024 * 1024, 'B');
+    while(!g_stop)
+    {
+        ssize_t n = ::write(fd, buf.data(), buf.size());
+        if(n <= 0)
+        {
+            break;
+        }
+        g_bulkBytes += n;
+    }
+    ::close(fd);
+}
+
+static void smallThread(uint16_t port)
+{
+    int fd = connectTo(port);
+    char ping[KPingSize];
+    memset(ping, 'p', sizeof ping);
+    char pong[KPingSize];
+    std::vector<int64_t> samples;
+    while(!g_stop)
+    {
+        int64_t start = nowNs();
+        if(::write(fd, ping, sizeof ping) != sizeof ping)
+        {
+            break;
+        }
+        size_t received = 0;
+        while(received < sizeof pong)
+        {
+            ssize_t n = ::read(fd, pong + received, sizeof pong - received);
+            if(n <= 0)
+            {
+                break;
+            }
+            received += n;
+        }
+        samples.push_back(nowNs() - start);
+        ::usleep(1000);
+    }
+    ::close(fd);
+    std::unique_lock<std::mutex> lock(g_mutex);
+    g_samples.insert(g_samples.end(), samples.begin(), samples.end());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t budgetKB = argc > 1 ? atoi(argv[1]) : 0;
+    bool edgeTriggered = argc > 2 && atoi(argv[2]) != 0;
+    int numSmall = argc > 3 ? atoi(argv[3]) : 32;
+    int seconds = argc > 4 ? atoi(argv[4]) : 5;
+    uint16_t port = 9986;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "FairBench");
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            if(*buf->peek() == 'B')
+            {
+                buf->retrieveAll();
+            }
+            else
+            {
+                conn->send(buf);
+            }
+        });
+        server.setThreadNum(1); // 所有连接都在同一个subloop上
+        server.setEdgeTriggered(edgeTriggered);
+        server.setReadBudget(budgetKB * 1024);
+        server.start();
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    std::thread bulk(bulkThread, port);
+    std::vector<std::thread> smalls;
+    for(int i = 0;i < numSmall;i++)
+    {
+        smalls.emplace_back(smallThread, port);
+    }
+    ::sleep(seconds);
+    g_stop = true;
+    for(std::thread &t : smalls)
+    {
+        t.join();
+    }
+    bulk.detach(); // 可能阻塞在write上，进程退出的时候一起结束
+
+    std::sort(g_samples.begin(), g_samples.end());
+    printf("budget=%zuKB%s small=%d bulk=%.1f MB/s small rtt p50=%.1fus p99=%.1fus p999=%.1fus\n",
+        budgetKB, edgeTriggered ? "(ET)" : "", numSmall, g_bulkBytes / (1024.0 * 1024.0) / seconds,
+        g_samples[g_samples.size() / 2] / 1000.0,
+        g_samples[g_samples.size() * 99 / 100] / 1000.0,
+        g_samples[g_samples.size() * 999 / 1000] / 1000.0);
+    fflush(stdout);
+    ::_exit(0); // server线程还在loop中，直接退出
+}
@@ -0,0 +1,193 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * 大文件(大数据量)发送压测  对比pread到用户态再send、sendFile(sendfile零拷贝)、内存片send(ChainBuffer)和MSG_ZEROCOPY
+ * ./filebench [模式 0:pread+send 1:sendFile 2:内存片 3:内存片+MSG_ZEROCOPY] [并发client数] [文件大小MB] [server线程数]
+ * 每个client连上以后服务端把整个文件发过去再shutdown，client读到EOF为止
+ * 模式2/3不读文件，反复发送同一块16MB的内存；loopback上内核总是会拷贝，MSG_ZEROCOPY要在真实网卡上才有收益
+*/
+static const size_t KChunkSize = 64 * 1024;
+static const size_t KPayloadSize = 16 * 1024 * 1024;
+
+static std::atomic<int64_t> g_received(0);
+
+// pread+send模式下每个连接已经发送到的文件偏移
+static std::mutex g_mutex;
+static std::unordered_map<TcpConnection*, off_t> g_offsets;
+
+static void clientThread(uint16_t port, int64_t fileSize)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::vector<char> buf(1024 * 1024);
+    int64_t total = 0;
+    ssize_t n = 0;
+    while((n = ::read(fd, buf.data(), buf.size())) > 0)
+    {
+        total += n;
+    }
+    ::close(fd);
+    if(total != fileSize)
+    {
+        fprintf(stderr, "short read %ld of %ld\n", total, fileSize);
+    }
+    g_received += total;
+}
+
+// 发送下一块，文件发完了就关闭连接
+static void sendNextChunk(const TcpConnectionPtr &conn, int fileFd, int64_t fileSize)
+{
+    off_t offset = 0;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        offset = g_offsets[conn.get()];
+        g_offsets[conn.get()] = offset + KChunkSize;
+    }
+    if(offset >= fileSize)
+    {
+        conn->shutdown();
+        return;
+    }
+    std::string chunk(std::min<int64_t>(KChunkSize, fileSize - offset), '\0');
+    ssize_t n = ::pread(fileFd, &chunk[0], chunk.size(), offset);
+    chunk.resize(n > 0 ? n : 0);
+    conn->send(chunk);
+}
+
+// 发送下一段内存片，不拷贝，payload由ChainBuffer持有到发送完成(零拷贝时到内核的完成通知)
+static void sendNextPayload(const TcpConnectionPtr &conn, const std::shared_ptr<std::string> &payload, int64_t fileSize)
+{
+    off_t offset = 0;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        offset = g_offsets[conn.get()];
+        g_offsets[conn.get()] = offset + payload->size();
+    }
+    if(offset >= fileSize)
+    {
+        conn->shutdown();
+        return;
+    }
+    ChainBuffer chain;
+    chain.appendSlice(payload->data(), std::min<int64_t>(payload->size(), fileSize - offset), payload);
+    conn->send(&chain);
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : 1;
+    int numClients = argc > 2 ? atoi(argv[2]) : 16;
+    int64_t fileSize = (argc > 3 ? atoll(argv[3]) : 1024) * 1024 * 1024;
+    int serverThreads = argc > 4 ? atoi(argv[4]) : 4;
+    uint16_t port = 9984;
+
+    // 稀疏文件，内容全是0，读的时候都在page cache里
+    char path[] = "/tmp/filebenchXXXXXX";
+    int fileFd = ::mkstemp(path);
+    if(fileFd < 0 || ::ftruncate(fileFd, fileSize) < 0)
+    {
+        perror("create file");
+        return 1;
+    }
+    ::unlink(path);
+    std::shared_ptr<std::string> payload(new std::string(KPayloadSize, 'p'));
+
+    EventLoop *serverLoop = nullptr;
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "FileBench");
+        server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if(!conn->connected())
+            {
+                std::unique_lock<std::mutex> lock(g_mutex);
+                g_offsets.erase(conn.get());
+                return;
+            }
+            if(mode == 1)
+            {
+                conn->sendFile(fileFd, 0, fileSize);
+            }
+            else if(mode >= 2)
+            {
+                if(mode == 3)
+                {
+                    conn->setZeroCopy(64 * 1024);
+                }
+                sendNextPayload(conn, payload, fileSize);
+            }
+            else
+            {
+                sendNextChunk(conn, fileFd, fileSize);
+            }
+        });
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            buf->retrieveAll();
+        });
+        server.setWriteCompleteCallback([&](const TcpConnectionPtr &conn) {
+            if(mode == 1)
+            {
+                conn->shutdown();
+            }
+            else if(mode >= 2)
+            {
+                sendNextPayload(conn, payload, fileSize);
+            }
+            else
+            {
+                sendNextChunk(conn, fileFd, fileSize);
+            }
+        });
+        server.setThreadNum(serverThreads);
+        server.start();
+        serverLoop = &loop;
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    Timestamp start = Timestamp::now();
+    std::vector<std::thread> clients;
+    for(int i = 0;i < numClients;i++)
+    {
+        clients.emplace_back(clientThread, port, fileSize);
+    }
+    for(std::thread &t : clients)
+    {
+        t.join();
+    }
+    double seconds = (Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+    serverLoop->quit();
+    server.join();
+    ::close(fileFd);
+
+    const char *modeNames[] = { "pread+send", "sendFile", "slice", "slice+zerocopy" };
+    printf("mode=%s clients=%d file=%ldMB total=%.1fs throughput: %.1f MB/s\n",
+        modeNames[mode], numClients, fileSize / (1024 * 1024),
+        seconds, g_received / (1024.0 * 1024.0) / seconds);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoopThread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/**
+ * 忙轮询模式的延迟测试，分别测阻塞模式和忙轮询模式的p50/p99往返延迟
+ * handoff: 其它线程queueInLoop一个回调，等loop执行完回来  (跨线程投递 + eventfd唤醒)
+ * tcp:     单连接的1字节ping-pong  (网络事件从epoll_wait中唤醒)
+ * ./latencybench [次数] [自旋微秒]
+*/
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, int spinUs, std::vector<int64_t> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    printf("%-8s busypoll=%-6d p50=%6.1fus p99=%6.1fus\n", name, spinUs,
+        samples[samples.size() / 2] / 1000.0,
+        samples[samples.size() * 99 / 100] / 1000.0);
+}
+
+static void benchHandoff(int iterations, int spinUs)
+{
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    loop->setBusyPoll(spinUs);
+
+    std::atomic<int> done(0);
+    std::vector<int64_t> samples;
+    samples.reserve(iterations);
+    for(int i = 1;i <= iterations;i++)
+    {
+        int64_t start = nowNs();
+        loop->queueInLoop([&done, i]() { done.store(i, std::memory_order_release); });
+        while(done.load(std::memory_order_acquire) != i) {}
+        samples.push_back(nowNs() - start);
+        ::usleep(10); // 模拟请求之间的间隔，阻塞模式下loop会睡回epoll_wait
+    }
+    report("handoff", spinUs, samples);
+}
+
+static void benchTcp(int iterations, int spinUs, uint16_t port)
+{
+    std::thread server([=]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "LatencyBench");
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf->retrieveAllAsString());
+        });
+        server.setThreadNum(1);
+        server.setBusyPoll(1, spinUs);
+        server.start();
+        loop.runAfter(1.0 + iterations * 0.0001, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(200 * 1000);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if(::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    std::vector<int64_t> samples;
+    samples.reserve(iterations);
+    char c = 'x';
+    for(int i = 0;i < iterations;i++)
+    {
+        int64_t start = nowNs();
+        ::write(fd, &c, 1);
+        ::read(fd, &c, 1);
+        samples.push_back(nowNs() - start);
+    }
+    ::close(fd);
+    report("tcp", spinUs, samples);
+    server.join();
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    int spinUs = argc > 2 ? atoi(argv[2]) : 1000;
+
+    benchHandoff(iterations, 0);
+    benchHandoff(iterations, spinUs);
+    benchTcp(iterations, 0, 9982);
+    benchTcp(iterations, spinUs, 9983);
+    return 0;
+}
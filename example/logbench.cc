@@ -0,0 +1,206 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/AsyncLogging.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * 日志压测  同步写文件(每一行fflush，和原来std::endl的行为一样) 对比 AsyncLogging
+ * ./logbench [模式 0:同步 1:异步] [写日志线程数] [每个线程的行数] [echo秒数] [日志文件前缀]
+ * 1. 多个线程一起LOG_INFO，每秒多少行  前端的格式化(时间、snprintf)也算在里面
+ *    另外单独测一次只调用输出端(已经格式化好的一行)，看后端本身的差别
+ * 2. 打开INFO日志(poll/updateChannel/连接建立断开都会打日志)的echo，每秒多少次往返
+*/
+static std::atomic<int64_t> g_roundTrips(0);
+static std::atomic<bool> g_stop(false);
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void logThread(int lines)
+{
+    for(int i = 0;i < lines;i++)
+    {
+        LOG_INFO("logbench line %d from a front-end thread, some payload abcdefghijklmnopqrstuvwxyz", i);
+    }
+}
+
+static void sinkThread(const Logger::OutputFunc &sink, int lines)
+{
+    char line[128];
+    int len = snprintf(line, sizeof line, "[INFO]2026/01/01 00:00:00 : logbench raw line from a front-end thread, some payload abcdefghijklmnopqrstuvwxyz\n");
+    for(int i = 0;i < lines;i++)
+    {
+        sink(line, len);
+    }
+}
+
+static double runThreads(int numThreads, std::function<void()> func)
+{
+    double start = nowSec();
+    std::vector<std::thread> threads;
+    for(int i = 0;i < numThreads;i++)
+    {
+        threads.emplace_back(func);
+    }
+    for(std::thread &t : threads)
+    {
+        t.join();
+    }
+    return nowSec() - start;
+}
+
+static void echoClient(int numConns, uint16_t port)
+{
+    const size_t KMsgSize = 64;
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<char> msg(KMsgSize, 'x');
+    std::vector<size_t> received(numConns, 0);
+    std::vector<int> fds;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    for(int i = 0;i < numConns;i++)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+        ::write(fd, msg.data(), msg.size());
+    }
+
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(64 * 1024);
+    while(!g_stop)
+    {
+        int n = ::epoll_wait(epfd, events.data(), events.size(), 100);
+        for(int i = 0;i < n;i++)
+        {
+            int idx = events[i].data.u32;
+            ssize_t r = ::read(fds[idx], buf.data(), buf.size());
+            if(r <= 0)
+            {
+                continue;
+            }
+            received[idx] += r;
+            if(received[idx] >= KMsgSize)
+            {
+                received[idx] -= KMsgSize;
+                ++g_roundTrips;
+                ::write(fds[idx], msg.data(), msg.size());
+            }
+        }
+    }
+
+    for(int fd : fds)
+    {
+        ::close(fd);
+    }
+    ::close(epfd);
+}
+
+int main(int argc, char *argv[])
+{
+    int mode = argc > 1 ? atoi(argv[1]) : 1;
+    int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int linesPerThread = argc > 3 ? atoi(argv[3]) : 250000;
+    int seconds = argc > 4 ? atoi(argv[4]) : 5;
+    std::string basename = argc > 5 ? argv[5] : "/tmp/logbench";
+    uint16_t port = 9986;
+
+    FILE *syncFile = nullptr;
+    std::unique_ptr<AsyncLogging> asyncLog;
+    Logger::OutputFunc sink;
+    if(mode == 0)
+    {
+        syncFile = ::fopen((basename + ".sync.log").c_str(), "w");
+        if(syncFile == nullptr)
+        {
+            perror("fopen");
+            return 1;
+        }
+        sink = [syncFile](const char *msg, size_t len) {
+            ::fwrite(msg, 1, len, syncFile);
+            ::fflush(syncFile);
+        };
+    }
+    else
+    {
+        asyncLog.reset(new AsyncLogging(basename, 1024 * 1024 * 1024));
+        asyncLog->start();
+        AsyncLogging *log = asyncLog.get();
+        sink = [log](const char *msg, size_t len) { log->append(msg, len); };
+        Logger::instance().setFlush([log]() { log->flush(); });
+    }
+    Logger::instance().setOutput(sink);
+
+    // 1. 每秒多少行
+    int64_t lines = static_cast<int64_t>(numThreads) * linesPerThread;
+    double logElapsed = runThreads(numThreads, std::bind(logThread, linesPerThread));
+    double sinkElapsed = runThreads(numThreads, std::bind(sinkThread, std::cref(sink), linesPerThread));
+
+    // 2. 打开INFO日志的echo
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "LogBench");
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf->retrieveAllAsString());
+        });
+        server.setThreadNum(1);
+        server.start();
+        loop.runAfter(seconds + 2, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+    std::thread client(echoClient, 16, port);
+    ::sleep(1);
+    int64_t startTrips = g_roundTrips;
+    ::sleep(seconds);
+    int64_t trips = g_roundTrips - startTrips;
+    g_stop = true;
+    client.join();
+    server.join();
+
+    if(asyncLog)
+    {
+        asyncLog->stop();
+    }
+    else
+    {
+        ::fclose(syncFile);
+    }
+    printf("mode=%s threads=%d LOG_INFO lines/s: %.0f  output-only lines/s: %.0f  echo round trips/s with INFO: %ld  dropped: %ld\n",
+        mode == 0 ? "sync" : "async", numThreads, lines / logElapsed, lines / sinkElapsed, trips / seconds,
+        asyncLog ? asyncLog->droppedMessages() : 0L);
+    fflush(stdout);
+    _exit(0); // Logger的输出端引用着上面的对象，不再走静态析构
+}
@@ -0,0 +1,54 @@
+#include <mymuduo/BinaryLog.h>
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+/**
+ * 把Logger::setBinaryFormat(true)写出的二进制日志还原成文本，输出到stdout
+ * ./logdecode server.20260101-000000.host.123.log [后面滚动出来的文件...]
+ * 格式串记录只在第一次用到的时候写一次，多个滚动文件要从第一个开始按顺序给
+*/
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s binary-log-file...\n", argv[0]);
+        return 1;
+    }
+
+    BinaryLogDecoder decoder;
+    std::vector<char> buf(4 * 1024 * 1024);
+    std::string pending; // 上一次读剩下的半条记录
+    std::string text;
+    for(int i = 1;i < argc;i++)
+    {
+        FILE *fp = ::fopen(argv[i], "rb");
+        if(fp == nullptr)
+        {
+            perror(argv[i]);
+            return 1;
+        }
+        size_t n = 0;
+        while((n = ::fread(buf.data(), 1, buf.size(), fp)) > 0)
+        {
+            pending.append(buf.data(), n);
+            size_t used = decoder.decode(pending.data(), pending.size(), &text);
+            pending.erase(0, used);
+            ::fwrite(text.data(), 1, text.size(), stdout);
+            text.clear();
+            if(decoder.error())
+            {
+                fprintf(stderr, "%s: corrupted record\n", argv[i]);
+                ::fclose(fp);
+                return 1;
+            }
+        }
+        ::fclose(fp);
+    }
+    if(!pending.empty())
+    {
+        fprintf(stderr, "%zu bytes of truncated record at the end\n", pending.size());
+    }
+    return 0;
+}
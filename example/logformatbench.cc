@@ -0,0 +1,72 @@
+#include <mymuduo/Logger.h>
+#include <mymuduo/BinaryLog.h>
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * 日志前端的开销  每一条LOG_INFO多少ns，输出端什么都不做
+ * ./logformatbench [次数]
+ * 1. INFO关闭(运行时的最低级别设成ERROR)
+ * 2. 文本格式
+ * 3. 二进制格式，并且解码一次和文本格式对比
+*/
+static size_t g_bytes = 0;
+static std::string g_captured;
+static bool g_capture = false;
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double measure(int count)
+{
+    const char *name = "conn-127.0.0.1:9981#42";
+    double start = nowSec();
+    for(int i = 0;i < count;i++)
+    {
+        LOG_INFO("TcpConnection::ctor[%s] at fd=%d bytes=%lu ratio=%.2f \n", name, i, static_cast<unsigned long>(i) * 64, i / 3.0);
+    }
+    return (nowSec() - start) / count * 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    Logger::instance().setOutput([](const char *msg, size_t len) {
+        g_bytes += len;
+        if(g_capture)
+        {
+            g_captured.append(msg, len);
+        }
+    });
+
+    Logger::setLogLevel(ERROR);
+    double disabled = measure(count);
+    Logger::setLogLevel(INFO);
+    g_bytes = 0;
+    double text = measure(count);
+    size_t textBytes = g_bytes / count;
+    Logger::instance().setBinaryFormat(true);
+    g_bytes = 0;
+    double binary = measure(count);
+    size_t binaryBytes = g_bytes / count;
+
+    printf("LOG_INFO ns/line: disabled %.2f  text %.1f (%zu bytes)  binary %.1f (%zu bytes)\n",
+        disabled, text, textBytes, binary, binaryBytes);
+
+    // 解码出来的应该和文本格式一样(时间戳除外)
+    g_capture = true;
+    LOG_INFO("check %s %d %u %ld %x %5.1f %p %c %%", "str", -1, 2u, -3L, 255, 3.14159, (void*)0x1234, 'z');
+    BinaryLogDecoder decoder;
+    std::string decoded;
+    decoder.decode(g_captured.data(), g_captured.size(), &decoded);
+    printf("decoded: %s", decoded.c_str());
+    fflush(stdout);
+    return 0;
+}
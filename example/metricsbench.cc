@@ -0,0 +1,230 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoopThreadPool.h>
+#include <mymuduo/LoopMetrics.h>
+#include <mymuduo/MetricsServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * loop运行指标  echo压测的同时，主线程每秒从EventLoopThreadPool::metricsSnapshot读一次各个subloop的指标
+ * ./metricsbench [连接数] [server线程数] [秒数]
+ * 最后给出 LatencyHistogram::record 和 一次snapshot 的开销
+ * 同时在9988端口开一个MetricsServer，结束前抓一次/metrics和/connections?top=3，给出一次抓取的耗时
+*/
+static std::atomic<bool> g_stop(false);
+
+static void clientThread(int numConns, uint16_t port)
+{
+    const size_t KMsgSize = 64;
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<char> msg(KMsgSize, 'x');
+    std::vector<int> fds;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    for(int i = 0;i < numConns;i++)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+        ::write(fd, msg.data(), msg.size());
+    }
+
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(64 * 1024);
+    while(!g_stop)
+    {
+        int n = ::epoll_wait(epfd, events.data(), events.size(), 100);
+        for(int i = 0;i < n;i++)
+        {
+            int idx = events[i].data.u32;
+            ssize_t r = ::read(fds[idx], buf.data(), buf.size());
+            if(r > 0)
+            {
+                ::write(fds[idx], msg.data(), msg.size());
+            }
+        }
+    }
+
+    for(int fd : fds)
+    {
+        ::close(fd);
+    }
+    ::close(epfd);
+}
+
+// 一个HTTP GET，读到对端关闭为止
+static std::string httpGet(uint16_t port, const char *path)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect metrics");
+        exit(1);
+    }
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::write(fd, request.data(), request.size());
+    std::string response;
+    char buf[64 * 1024];
+    ssize_t n;
+    while((n = ::read(fd, buf, sizeof buf)) > 0)
+    {
+        response.append(buf, n);
+    }
+    ::close(fd);
+    return response;
+}
+
+static void printSnapshot(size_t index, const LoopMetrics::Snapshot &now, const LoopMetrics::Snapshot &last)
+{
+    uint64_t iterations = now.iterations - last.iterations;
+    uint64_t busy = now.busyNs - last.busyNs;
+    uint64_t wait = now.pollWaitNs - last.pollWaitNs;
+    printf("loop%zu conns=%d iter/s=%lu util=%.2f lag p50=%.1fus p99=%.1fus max=%.1fus"
+        "  poll wait p50=%.1fus  events/wakeup mean=%.1f p99=%lu  functor depth p99=%lu pending=%d\n",
+        index, now.connections, iterations,
+        busy + wait > 0 ? static_cast<double>(busy) / (busy + wait) : 0.0,
+        now.loopLag.percentile(50) / 1e3, now.loopLag.percentile(99) / 1e3, now.loopLag.max / 1e3,
+        now.pollWait.percentile(50) / 1e3,
+        now.eventsPerWakeup.mean(), now.eventsPerWakeup.percentile(99),
+        now.functorQueueDepth.percentile(99), now.pendingFunctors);
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 1000;
+    int serverThreads = argc > 2 ? atoi(argv[2]) : 2;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    uint16_t port = 9987;
+    Logger::setLogLevel(ERROR);
+
+    uint16_t metricsPort = 9988;
+    std::shared_ptr<EventLoopThreadPool> pool;
+    TcpServer *echoServer = nullptr;
+    std::atomic<bool> started(false);
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "MetricsBench");
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf->retrieveAllAsString());
+        });
+        server.setThreadNum(serverThreads);
+        server.start();
+        pool = server.threadPool();
+        echoServer = &server;
+        started = true;
+        loop.runAfter(seconds + 2, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    while(!started)
+    {
+        ::usleep(10 * 1000);
+    }
+    MetricsServer metrics{InetAddress(metricsPort)};
+    metrics.addServer(echoServer);
+    metrics.start();
+    ::usleep(500 * 1000);
+    std::thread client(clientThread, numConns, port);
+
+    std::vector<LoopMetrics::Snapshot> last = pool->metricsSnapshot();
+    for(int s = 0;s < seconds;s++)
+    {
+        ::sleep(1);
+        std::vector<LoopMetrics::Snapshot> now = pool->metricsSnapshot();
+        for(size_t i = 0;i < now.size();i++)
+        {
+            printSnapshot(i, now[i], last[i]);
+        }
+        last.swap(now);
+    }
+
+    // 开销
+    const int KRounds = 1000;
+    int64_t start = LoopMetrics::nowNs();
+    for(int i = 0;i < KRounds;i++)
+    {
+        std::vector<LoopMetrics::Snapshot> snap = pool->metricsSnapshot();
+    }
+    double snapshotUs = (LoopMetrics::nowNs() - start) / 1e3 / KRounds;
+
+    // 通过MetricsServer抓取
+    const int KScrapes = 20;
+    std::string scraped;
+    start = LoopMetrics::nowNs();
+    for(int i = 0;i < KScrapes;i++)
+    {
+        scraped = httpGet(metricsPort, "/metrics");
+    }
+    double scrapeUs = (LoopMetrics::nowNs() - start) / 1e3 / KScrapes;
+    size_t pos = 0;
+    while((pos = scraped.find("\nmymuduo_", pos)) != std::string::npos)
+    {
+        size_t eol = scraped.find('\n', pos + 1);
+        std::string line = scraped.substr(pos + 1, eol - pos - 1);
+        if(line.find("loop=") == std::string::npos || line.find("loop=\"0\"") != std::string::npos)
+        {
+            printf("%s\n", line.c_str()); // 每个指标只打印第一个loop的
+        }
+        pos = eol;
+    }
+    std::string top = httpGet(metricsPort, "/connections?top=3");
+    printf("%s", top.substr(top.find("\r\n\r\n") + 4).c_str());
+    printf("/metrics scrape %.1f us (%zu bytes)\n", scrapeUs, scraped.size());
+
+    g_stop = true;
+    client.join();
+    server.join();
+
+    const int KRecords = 10 * 1000 * 1000;
+    std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram);
+    start = LoopMetrics::nowNs();
+    for(int i = 0;i < KRecords;i++)
+    {
+        histogram->record(static_cast<uint64_t>(i) * 2654435761u % 1000000);
+    }
+    double recordNs = static_cast<double>(LoopMetrics::nowNs() - start) / KRecords;
+    int64_t clockStart = LoopMetrics::nowNs();
+    int64_t sink = 0;
+    for(int i = 0;i < KRecords;i++)
+    {
+        sink += LoopMetrics::nowNs();
+    }
+    double clockNs = static_cast<double>(LoopMetrics::nowNs() - clockStart) / KRecords;
+
+    printf("record %.2f ns  clock_gettime %.2f ns  snapshot of %zu loops %.1f us  (%ld)\n",
+        recordNs, clockNs, last.size(), snapshotUs, static_cast<long>(sink & 1));
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,68 @@
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/Timestamp.h>
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+/**
+ * EventLoop::queueInLoop的竞争压测
+ * 1~32个生产者线程同时往同一个sub loop投递回调，统计生产者的吞吐量以及loop全部执行完的时间
+*/
+static const int kTotal = 2000000;
+
+static int64_t g_executed = 0; // 只在loop线程中修改
+static std::atomic<bool> g_done(false);
+
+static double elapsedSeconds(Timestamp start)
+{
+    return static_cast<double>(Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch())
+         / Timestamp::kMicroSecondsPerSecond;
+}
+
+int main()
+{
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+
+    for(int producers = 1;producers <= 32;producers *= 2)
+    {
+        g_executed = 0;
+        g_done = false;
+        int perThread = kTotal / producers;
+        int64_t expected = static_cast<int64_t>(perThread) * producers;
+
+        Timestamp start(Timestamp::now());
+        std::vector<std::thread> threads;
+        for(int i = 0;i < producers;i++)
+        {
+            threads.emplace_back([loop, perThread, expected]() {
+                for(int j = 0;j < perThread;j++)
+                {
+                    loop->queueInLoop([expected]() {
+                        if(++g_executed == expected)
+                        {
+                            g_done = true;
+                        }
+                    });
+                }
+            });
+        }
+        for(std::thread &t : threads)
+        {
+            t.join();
+        }
+        double produceSeconds = elapsedSeconds(start);
+        while(!g_done)
+        {
+            std::this_thread::yield();
+        }
+        double totalSeconds = elapsedSeconds(start);
+
+        printf("producers=%2d  produce %.2f Mops/s  consume %.2f Mops/s\n",
+            producers, expected / produceSeconds / 1e6, expected / totalSeconds / 1e6);
+    }
+    return 0;
+}
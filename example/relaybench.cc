@@ -0,0 +1,261 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpRelay.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * 转发压测  对比 拷贝转发(onMessage => send) 和 TcpRelay(splice)
+ * ./relaybench [模式 0:拷贝 1:splice] [连接对数] [每对转发的MB数] [server线程数]
+ * 每一对: writer连接和reader连接，先各发4字节的头(pairId * 2 + 角色)，server配对之后给writer回一个'G'
+ * writer写完之后shutdown(SHUT_WR)，半关闭经过server传给reader，reader读到EOF结束
+*/
+static const size_t KChunkSize = 64 * 1024;
+
+static int g_mode = 0;
+static std::mutex g_mutex;
+static std::map<uint32_t, TcpConnectionPtr> g_waiting; // pairId => 先到的连接
+static std::map<uint32_t, uint32_t> g_roles; // 先到的连接的角色
+static std::map<TcpConnection*, std::weak_ptr<TcpConnection>> g_peers; // 拷贝模式下的对端
+static std::set<TcpConnection*> g_relayed; // splice模式下已经交给TcpRelay的连接
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connectTo(uint16_t port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+/**
+ * 先登记好配对再给writer发'G'  writer和reader可能在不同的loop上，writer收到'G'之后马上开始发数据，
+ * 这些数据可能在TcpRelay::attach之前就到了writer的onMessage，不能再被当成头部解析
+*/
+static void pairUp(const TcpConnectionPtr &writer, const TcpConnectionPtr &reader)
+{
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        if(g_mode == 0)
+        {
+            g_peers[writer.get()] = reader;
+            g_peers[reader.get()] = writer;
+        }
+        else
+        {
+            g_relayed.insert(writer.get());
+            g_relayed.insert(reader.get());
+        }
+    }
+    writer->send(std::string("G"));
+    if(g_mode != 0)
+    {
+        // 'G'在attach之前发出去  attach之前读到的数据留在inputBuffer_中，由TcpRelay先转发
+        std::shared_ptr<TcpRelay> relay(new TcpRelay(writer, reader));
+        relay->start();
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    TcpConnectionPtr peer;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        if(g_relayed.count(conn.get()) > 0)
+        {
+            return; // 等TcpRelay接管
+        }
+        auto it = g_peers.find(conn.get());
+        if(it != g_peers.end())
+        {
+            peer = it->second.lock();
+        }
+    }
+    if(peer)
+    {
+        peer->send(buf); // 拷贝转发
+        return;
+    }
+    if(buf->readableBytes() < sizeof(uint32_t))
+    {
+        return;
+    }
+
+    uint32_t header;
+    memcpy(&header, buf->peek(), sizeof header);
+    buf->retrieve(sizeof header);
+    uint32_t pairId = header / 2;
+    uint32_t role = header % 2;
+    TcpConnectionPtr other;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        auto it = g_waiting.find(pairId);
+        if(it == g_waiting.end())
+        {
+            g_waiting[pairId] = conn;
+            g_roles[pairId] = role;
+            return;
+        }
+        other = it->second;
+        g_waiting.erase(it);
+        g_roles.erase(pairId);
+    }
+    if(role == 0)
+    {
+        pairUp(conn, other);
+    }
+    else
+    {
+        pairUp(other, conn);
+    }
+}
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if(conn->connected())
+    {
+        return;
+    }
+    // 拷贝模式下的半关闭: 一边读到EOF，另一边发完之后shutdown
+    TcpConnectionPtr peer;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        g_relayed.erase(conn.get());
+        auto it = g_peers.find(conn.get());
+        if(it != g_peers.end())
+        {
+            peer = it->second.lock();
+            g_peers.erase(it);
+        }
+    }
+    if(peer)
+    {
+        peer->shutdown();
+    }
+}
+
+static void writerThread(uint16_t port, uint32_t pairId, size_t totalBytes)
+{
+    int fd = connectTo(port);
+    uint32_t header = pairId * 2;
+    ::write(fd, &header, sizeof header);
+    char go;
+    if(::read(fd, &go, 1) != 1)
+    {
+        perror("writer read");
+        exit(1);
+    }
+    std::vector<char> buf(KChunkSize, 'r');
+    size_t sent = 0;
+    while(sent < totalBytes)
+    {
+        ssize_t n = ::write(fd, buf.data(), std::min(buf.size(), totalBytes - sent));
+        if(n <= 0)
+        {
+            perror("writer write");
+            exit(1);
+        }
+        sent += n;
+    }
+    ::shutdown(fd, SHUT_WR);
+    while(::read(fd, buf.data(), buf.size()) > 0)
+    {
+    }
+    ::close(fd);
+}
+
+static void readerThread(uint16_t port, uint32_t pairId, size_t totalBytes, size_t *received)
+{
+    int fd = connectTo(port);
+    uint32_t header = pairId * 2 + 1;
+    ::write(fd, &header, sizeof header);
+    std::vector<char> buf(KChunkSize);
+    size_t total = 0;
+    while(true)
+    {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if(n <= 0)
+        {
+            break;
+        }
+        total += n;
+    }
+    ::close(fd);
+    *received = total;
+}
+
+int main(int argc, char *argv[])
+{
+    g_mode = argc > 1 ? atoi(argv[1]) : 0;
+    int numPairs = argc > 2 ? atoi(argv[2]) : 4;
+    size_t megabytes = argc > 3 ? atoi(argv[3]) : 1024;
+    int numThreads = argc > 4 ? atoi(argv[4]) : 2;
+    uint16_t port = 9987;
+    size_t totalBytes = megabytes * 1024 * 1024;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "RelayBench");
+        server.setConnectionCallback(onConnection);
+        server.setMessageCallback(onMessage);
+        server.setThreadNum(numThreads); // 一对连接的两端可能在不同的subloop上
+        server.start();
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    double start = nowSec();
+    std::vector<size_t> received(numPairs, 0);
+    std::vector<std::thread> threads;
+    for(int i = 0;i < numPairs;i++)
+    {
+        threads.emplace_back(readerThread, port, i, totalBytes, &received[i]);
+        threads.emplace_back(writerThread, port, i, totalBytes);
+    }
+    for(std::thread &t : threads)
+    {
+        t.join();
+    }
+    double seconds = nowSec() - start;
+
+    size_t total = 0;
+    bool complete = true;
+    for(size_t n : received)
+    {
+        total += n;
+        complete = complete && n == totalBytes;
+    }
+    printf("mode=%s pairs=%d %zuMB/pair %.2fs %.1f MB/s %s\n",
+        g_mode == 0 ? "copy" : "splice", numPairs, megabytes, seconds,
+        total / (1024.0 * 1024.0) / seconds, complete ? "complete" : "INCOMPLETE");
+    fflush(stdout);
+    ::_exit(0); // server线程还在loop中，直接退出
+}
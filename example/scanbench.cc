@@ -0,0 +1,109 @@
+#include <mymuduo/Buffer.h>
+#include <mymuduo/ByteScan.h>
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * 分隔符查找压测  Buffer::findCRLF/findEOL/findAny 在 标量/SSE2/AVX2 三种实现下的吞吐
+ * ./scanbench
+ * 1. 1KB ~ 1MB 的数据，分隔符在最后  findEOL(单个分隔符)用的是memchr，作为参照
+ * 2. 半包: 一个64KB的行按1KB一次到达，每次到达都findCRLF一次，对比 记住扫描位置 和 每次从头扫
+*/
+static const size_t KTotalBytes = 256 * 1024 * 1024; // 每一项测试一共扫描的字节数
+static volatile size_t g_sink;
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+template <typename Find>
+static double measure(size_t size, Find find)
+{
+    size_t rounds = KTotalBytes / size;
+    double start = nowSec();
+    for(size_t i = 0;i < rounds;i++)
+    {
+        g_sink += reinterpret_cast<size_t>(find());
+    }
+    return static_cast<double>(rounds) * size / (nowSec() - start) / (1024.0 * 1024 * 1024);
+}
+
+static void throughput(const char *name)
+{
+    const size_t sizes[] = { 1024, 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+    for(size_t size : sizes)
+    {
+        std::string data(size, 'a');
+        for(size_t i = 0;i < size;i++)
+        {
+            data[i] = 'a' + rand() % 26;
+        }
+        data[size - 2] = '\r';
+        data[size - 1] = '\n';
+        const char *begin = data.data();
+        const char *end = begin + size;
+        const char delimiters[] = { ' ', ';', ',', '\n' };
+        const char pair[] = { ';', '\n' };
+
+        double crlf = measure(size, [=]() { return ByteScan::findCRLF(begin, end); });
+        double any2 = measure(size, [&]() { return ByteScan::findAny(begin, end, pair, sizeof pair); });
+        double any4 = measure(size, [&]() { return ByteScan::findAny(begin, end, delimiters, sizeof delimiters); });
+        double eol = measure(size, [=]() { return ByteScan::findByte(begin, end, '\n'); });
+        printf("%-6s %5zuKB  findCRLF %6.2f GB/s  findAny(2) %6.2f GB/s  findAny(4) %6.2f GB/s  findEOL %6.2f GB/s\n",
+            name, size / 1024, crlf, any2, any4, eol);
+    }
+}
+
+// 一行64KB按1KB一次到达
+static double partialLine(bool resume)
+{
+    const size_t KLineSize = 64 * 1024;
+    const size_t KChunk = 1024;
+    std::string chunk(KChunk, 'x');
+    const int rounds = 200;
+    double start = nowSec();
+    for(int r = 0;r < rounds;r++)
+    {
+        Buffer buf;
+        for(size_t received = 0;received < KLineSize;received += KChunk)
+        {
+            if(received + KChunk == KLineSize)
+            {
+                chunk[KChunk - 2] = '\r';
+                chunk[KChunk - 1] = '\n';
+            }
+            buf.append(chunk.data(), chunk.size());
+            const char *crlf = resume
+                ? buf.findCRLF()
+                : ByteScan::findCRLF(buf.peek(), buf.peek() + buf.readableBytes());
+            g_sink += reinterpret_cast<size_t>(crlf);
+        }
+        chunk[KChunk - 2] = chunk[KChunk - 1] = 'x';
+    }
+    return (nowSec() - start) / rounds * 1e6;
+}
+
+int main()
+{
+    const ByteScan::Implementation impls[] = { ByteScan::KScalar, ByteScan::KSSE2, ByteScan::KAVX2 };
+    ByteScan::Implementation best = ByteScan::implementation();
+    for(ByteScan::Implementation impl : impls)
+    {
+        if(ByteScan::setImplementation(impl))
+        {
+            throughput(ByteScan::implementationName());
+        }
+    }
+    ByteScan::setImplementation(best);
+    printf("64KB line in 1KB chunks (%s): rescan %.1fus  resume %.1fus\n",
+        ByteScan::implementationName(), partialLine(false), partialLine(true));
+    return 0;
+}
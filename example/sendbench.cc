@@ -0,0 +1,121 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+#include <mymuduo/Slice.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * 跨线程send压测  业务线程调用TcpConnection::send，数据由subloop线程发送
+ * 对比 const std::string&(拷贝)、std::string&&(转移所有权)、Slice(引用计数，同一份数据反复发送)
+ * ./sendbench [每种消息大小发送的总MB数]
+ * 消息大小从64B到1MB，client线程读到收齐为止
+*/
+static std::atomic<int64_t> g_received(0);
+
+static void clientThread(int fd, int64_t total)
+{
+    std::vector<char> buf(1024 * 1024);
+    int64_t received = 0;
+    while(received < total)
+    {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if(n <= 0)
+        {
+            break;
+        }
+        received += n;
+    }
+    g_received = received;
+}
+
+static double runOnce(const TcpConnectionPtr &conn, int fd, int mode, size_t msgSize, size_t count)
+{
+    std::thread client(clientThread, fd, static_cast<int64_t>(msgSize * count));
+    std::string message(msgSize, 'x');
+    Slice slice(std::string(msgSize, 'x'));
+
+    Timestamp start = Timestamp::now();
+    for(size_t i = 0;i < count;i++)
+    {
+        if(mode == 0)
+        {
+            conn->send(message);
+        }
+        else if(mode == 1)
+        {
+            std::string copy(message); // 业务线程生成的消息，交出所有权
+            conn->send(std::move(copy));
+        }
+        else
+        {
+            conn->send(slice);
+        }
+    }
+    client.join();
+    return (Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t totalMB = argc > 1 ? atoi(argv[1]) : 128;
+    uint16_t port = 9985;
+
+    std::promise<TcpConnectionPtr> connected;
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "SendBench");
+        server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if(conn->connected())
+            {
+                connected.set_value(conn);
+            }
+        });
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            buf->retrieveAll();
+        });
+        server.setThreadNum(1);
+        server.start();
+        loop.runAfter(600, [&loop]() { loop.quit(); });
+        loop.loop();
+    });
+    ::usleep(500 * 1000);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        return 1;
+    }
+    TcpConnectionPtr conn = connected.get_future().get();
+
+    const char *modeNames[] = { "const string&", "string&&", "Slice" };
+    for(size_t size = 64;size <= 1024 * 1024;size *= 4)
+    {
+        size_t count = totalMB * 1024 * 1024 / size;
+        for(int mode = 0;mode < 3;mode++)
+        {
+            double seconds = runOnce(conn, fd, mode, size, count);
+            printf("msg=%8zu %-14s %10.0f msgs/s %8.1f MB/s\n", size, modeNames[mode],
+                count / seconds, g_received / (1024.0 * 1024.0) / seconds);
+        }
+    }
+    ::close(fd);
+    fflush(stdout);
+    ::_exit(0);
+}
@@ -37,11 +37,11 @@ private:
     {
         if(conn->connected())
         {
-            LOG_INFO("connection UP : %s", conn->peerAddress().toIpPort().c_str());
+            LOG_INFO("connection UP : %s", conn->peerAddr().toIpPort().c_str());
         }
         else
         {
-            LOG_INFO("connection DOWN : %s", conn->peerAddress().toIpPort().c_str());
+            LOG_INFO("connection DOWN : %s", conn->peerAddr().toIpPort().c_str());
         }
     }
 
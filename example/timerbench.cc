@@ -0,0 +1,73 @@
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+/**
+ * TimerQueue的压测
+ * 1. 在loop线程里面添加N个定时器再全部取消，统计每秒能arm/cancel多少个定时器
+ * 2. 添加M个短延时的定时器，统计实际到期时间和期望到期时间的偏差(expiry latency)
+*/
+static const int kArmCount = 1000000;
+static const int kLatencyCount = 10000;
+
+static std::vector<int64_t> g_latencies;
+
+static void benchArmCancel(EventLoop *loop)
+{
+    std::vector<TimerId> ids;
+    ids.reserve(kArmCount);
+
+    Timestamp start(Timestamp::now());
+    for(int i = 0;i < kArmCount;i++)
+    {
+        // 都是很久以后才到期的定时器，保证在cancel之前不会触发
+        ids.push_back(loop->runAfter(60.0 + i % 1000, [](){}));
+    }
+    for(const TimerId &id : ids)
+    {
+        loop->cancel(id);
+    }
+    Timestamp end(Timestamp::now());
+
+    double seconds = static_cast<double>(end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch())
+                   / Timestamp::kMicroSecondsPerSecond;
+    printf("arm+cancel %d timers in %.3f s, %.0f ops/s\n",
+        kArmCount, seconds, 2 * kArmCount / seconds);
+}
+
+static void benchLatency(EventLoop *loop)
+{
+    g_latencies.reserve(kLatencyCount);
+    for(int i = 0;i < kLatencyCount;i++)
+    {
+        double delay = 0.001 * (i % 100 + 1); // 1ms ~ 100ms
+        Timestamp expected(addTime(Timestamp::now(), delay));
+        loop->runAt(expected, [loop, expected](){
+            g_latencies.push_back(Timestamp::now().microSecondsSinceEpoch()
+                                - expected.microSecondsSinceEpoch());
+            if(g_latencies.size() == kLatencyCount)
+            {
+                loop->quit();
+            }
+        });
+    }
+}
+
+int main()
+{
+    EventLoop loop;
+    benchArmCancel(&loop);
+    benchLatency(&loop);
+    loop.loop();
+
+    std::sort(g_latencies.begin(), g_latencies.end());
+    printf("expiry latency(us) p50=%ld p99=%ld max=%ld\n",
+        g_latencies[g_latencies.size() / 2],
+        g_latencies[g_latencies.size() * 99 / 100],
+        g_latencies.back());
+    return 0;
+}